@@ -83,9 +83,56 @@ extern "C" {
 
 #endif
 
-/* pools which are freely available */
+/* pools which are freely available, most recently freed first, and those
+ * which went unused long enough that their memory was given back */
 static ggc_mutex_t freePoolsLock = GGC_MUTEX_INITIALIZER;
-static struct GGGGC_Pool *freePoolsHead, *freePoolsTail;
+static struct GGGGC_Pool *freePools, *idlePools;
+
+/* the number of collections, as counted by ggggc_releaseIdlePools */
+static ggc_size_t poolEpoch;
+
+/* the size of a page, for decommitting */
+static ggc_size_t pageBytes(void)
+{
+#if _POSIX_VERSION
+    static ggc_size_t bytes;
+    if (!bytes) bytes = (ggc_size_t) sysconf(_SC_PAGESIZE);
+    return bytes;
+#elif defined(_WIN32)
+    static ggc_size_t bytes;
+    if (!bytes) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        bytes = info.dwPageSize;
+    }
+    return bytes;
+#else
+    return 4096;
+#endif
+}
+
+/* the parts of a free pool that can be decommitted: everything but the page(s)
+ * holding its list link and bookkeeping. Returns the number of ranges */
+static int idleRanges(struct GGGGC_Pool *pool, unsigned char **starts,
+                      ggc_size_t *sizes)
+{
+    ggc_size_t page = pageBytes();
+    unsigned char *base = (unsigned char *) pool;
+    unsigned char *keepStart = (unsigned char *) ((ggc_size_t) &pool->next & ~(page - 1));
+    unsigned char *keepEnd = (unsigned char *)
+        (((ggc_size_t) pool->start + page - 1) & ~(page - 1));
+    int ranges = 0;
+
+    if (keepStart > base) {
+        starts[ranges] = base;
+        sizes[ranges++] = keepStart - base;
+    }
+    if (keepEnd < base + GGGGC_POOL_BYTES) {
+        starts[ranges] = keepEnd;
+        sizes[ranges++] = base + GGGGC_POOL_BYTES - keepEnd;
+    }
+    return ranges;
+}
 
 /* allocate and initialize a pool */
 struct GGGGC_Pool *ggggc_newPool(int mustSucceed)
@@ -106,15 +153,26 @@ struct GGGGC_Pool *ggggc_newPool(int mustSucceed)
 
     ret = NULL;
 
-    /* try to reuse a pool */
-    if (freePoolsHead) {
+    /* try to reuse a pool, preferably one that's still resident */
+    if (freePools || idlePools) {
         ggc_mutex_lock_raw(&freePoolsLock);
-        if (freePoolsHead) {
-            ret = freePoolsHead;
-            freePoolsHead = freePoolsHead->next;
-            if (!freePoolsHead) freePoolsTail = NULL;
+        if (freePools) {
+            ret = freePools;
+            freePools = freePools->next;
+        } else if (idlePools) {
+            ret = idlePools;
+            idlePools = idlePools->next;
         }
         ggc_mutex_unlock(&freePoolsLock);
+
+        /* if it was decommitted, its pages come back as it's touched */
+        if (ret && !ret->freedAt) {
+            unsigned char *starts[2];
+            ggc_size_t sizes[2];
+            int ranges = idleRanges(ret, starts, sizes), i;
+            for (i = 0; i < ranges; i++)
+                recommitRange(starts[i], sizes[i]);
+        }
     }
 
     /* otherwise, allocate one */
@@ -130,56 +188,93 @@ struct GGGGC_Pool *ggggc_newPool(int mustSucceed)
     return ret;
 }
 
-/* heuristically expand a pool list if it has too many survivors
- * poolList: Pool list to expand
- * newPool: Function to allocate a new pool based on a prototype pool
- * ratio: As a power of two, portion of pool that should be survivors */
-void ggggc_expandPoolList(struct GGGGC_Pool *poolList,
-                          struct GGGGC_Pool *(*newPool)(struct GGGGC_Pool *),
-                          int ratio)
+/* the size in bytes of the span of a large pool for size words */
+#define LARGE_POOL_BYTES(size) \
+    (((ggc_size_t) (void *) ((struct GGGGC_Pool *) 0)->start + \
+      (size) * sizeof(ggc_size_t) + GGGGC_POOL_BYTES - 1) / GGGGC_POOL_BYTES * GGGGC_POOL_BYTES)
+
+/* allocate and initialize a large pool, spanning as many pools as it takes to
+ * hold size words. free is left at start + size */
+struct GGGGC_Pool *ggggc_newLargePool(ggc_size_t size, int mustSucceed)
 {
-    struct GGGGC_Pool *pool = poolList;
-    ggc_size_t space, survivors, poolCt;
+    struct GGGGC_Pool *ret;
+    ggc_size_t bytes = LARGE_POOL_BYTES(size);
 
-    if (!pool) return;
+    ret = (struct GGGGC_Pool *) allocSpan(bytes, mustSucceed);
+    if (!ret) return NULL;
 
-    /* first figure out how much space was used */
-    space = 0;
-    survivors = 0;
-    poolCt = 0;
-    while (1) {
-        space += pool->end - pool->start;
-        survivors += pool->survivors;
-        pool->survivors = 0;
-        poolCt++;
-        if (!pool->next) break;
-        pool = pool->next;
-    }
+    ret->next = NULL;
+    ret->free = ret->start + size;
+    ret->end = (ggc_size_t *) ((unsigned char *) ret + bytes);
 
-    /* now decide if it's too much */
-    if ((survivors<<ratio) > space) {
-        /* allocate more */
-        ggc_size_t i;
-        for (i = 0; i < poolCt; i++) {
-            pool->next = newPool(poolList);
-            pool = pool->next;
-            if (!pool) break;
-        }
+    return ret;
+}
+
+/* free a large pool. If its space can't be returned to the system, it's split
+ * into ordinary pools for reuse */
+void ggggc_freeLargePool(struct GGGGC_Pool *pool)
+{
+    ggc_size_t bytes = (unsigned char *) pool->end - (unsigned char *) pool;
+    struct GGGGC_Pool *head = NULL, *cur;
+    ggc_size_t i;
+
+    if (freeSpan(pool, bytes)) return;
+
+    for (i = bytes; i >= GGGGC_POOL_BYTES; i -= GGGGC_POOL_BYTES) {
+        cur = (struct GGGGC_Pool *) ((unsigned char *) pool + i - GGGGC_POOL_BYTES);
+        cur->next = head;
+        head = cur;
     }
+    ggggc_freeGeneration(head);
 }
 
 /* free a generation (used when a thread exits) */
 void ggggc_freeGeneration(struct GGGGC_Pool *pool)
 {
+    struct GGGGC_Pool *tail;
     if (!pool) return;
     ggc_mutex_lock_raw(&freePoolsLock);
-    if (freePoolsHead) {
-        freePoolsTail->next = pool;
-    } else {
-        freePoolsHead = pool;
+    for (tail = pool; ; tail = tail->next) {
+        tail->freedAt = poolEpoch + 1;
+        if (!tail->next) break;
+    }
+    tail->next = freePools;
+    freePools = pool;
+    ggc_mutex_unlock(&freePoolsLock);
+}
+
+/* count a collection, and give the memory of any pools which have been free
+ * for GGGGC_POOL_IDLE_COLLECTIONS collections back to the system */
+void ggggc_releaseIdlePools(void)
+{
+    static int unsupported = 0;
+    struct GGGGC_Pool *pool, **prev;
+    unsigned char *starts[2];
+    ggc_size_t sizes[2];
+    int ranges, i;
+
+    poolEpoch++;
+    if (!GGGGC_POOL_IDLE_COLLECTIONS || unsupported || !freePools) return;
+
+    ggc_mutex_lock_raw(&freePoolsLock);
+    prev = &freePools;
+    while ((pool = *prev)) {
+        if (poolEpoch + 1 - pool->freedAt < GGGGC_POOL_IDLE_COLLECTIONS) {
+            prev = &pool->next;
+            continue;
+        }
+
+        /* it's been idle long enough */
+        ranges = idleRanges(pool, starts, sizes);
+        for (i = 0; i < ranges; i++)
+            if (!decommitRange(starts[i], sizes[i])) unsupported = 1;
+        if (unsupported) break;
+
+        *prev = pool->next;
+        pool->freedAt = 0;
+        pool->next = idlePools;
+        idlePools = pool;
     }
-    while (pool->next) pool = pool->next;
-    freePoolsTail = pool;
     ggc_mutex_unlock(&freePoolsLock);
 }
 
@@ -213,13 +308,16 @@ struct GGGGC_Descriptor *ggggc_allocateDescriptorDescriptor(ggc_size_t size)
 {
     struct GGGGC_Descriptor *ret, *ddd = NULL;
     ggc_size_t ddSize;
+    int cache;
 
     /* check for minimum size */
     if (size < GGGGC_MINIMUM_OBJECT_SIZE)
         size = GGGGC_MINIMUM_OBJECT_SIZE;
 
-    /* check if we already have a descriptor */
-    if (ggggc_descriptorDescriptors[size])
+    /* check if we already have a descriptor. Only the descriptors of objects
+     * that fit in a pool are common enough to cache */
+    cache = (size < GGGGC_DESCRIPTOR_DESCRIPTORS);
+    if (cache && ggggc_descriptorDescriptors[size])
         return ggggc_descriptorDescriptors[size];
 
     /* need one description bit for every word in the object */
@@ -230,10 +328,12 @@ struct GGGGC_Descriptor *ggggc_allocateDescriptorDescriptor(ggc_size_t size)
         ddd = ggggc_allocateDescriptorDescriptor(ddSize);
 
     /* otherwise, need to allocate one. First lock the space */
-    ggc_mutex_lock_raw(&ggggc_descriptorDescriptorsLock);
-    if (ggggc_descriptorDescriptors[size]) {
-        ggc_mutex_unlock(&ggggc_descriptorDescriptorsLock);
-        return ggggc_descriptorDescriptors[size];
+    if (cache) {
+        ggc_mutex_lock_raw(&ggggc_descriptorDescriptorsLock);
+        if (ggggc_descriptorDescriptors[size]) {
+            ggc_mutex_unlock(&ggggc_descriptorDescriptorsLock);
+            return ggggc_descriptorDescriptors[size];
+        }
     }
 
     /* allocate the descriptor descriptor */
@@ -254,6 +354,7 @@ struct GGGGC_Descriptor *ggggc_allocateDescriptorDescriptor(ggc_size_t size)
 #endif
 
     /* put it in the list */
+    if (!cache) return ret;
     ggggc_descriptorDescriptors[size] = ret;
     ggc_mutex_unlock(&ggggc_descriptorDescriptorsLock);
     {
@@ -376,7 +477,9 @@ struct GGGGC_Descriptor *ggggc_allocateDescriptorT(ggc_size_t size, const unsign
 }
 #endif
 
-/* descriptor allocator for pointer arrays */
+/* descriptor allocator for pointer arrays. The descriptions of arrays of up
+ * to this many words of description are built on the stack */
+#define PA_ALLOCA_WORDS 1024
 struct GGGGC_Descriptor *ggggc_allocateDescriptorPA(ggc_size_t size)
 {
     ggc_size_t *pointers;
@@ -386,13 +489,17 @@ struct GGGGC_Descriptor *ggggc_allocateDescriptorPA(ggc_size_t size)
     /* fill our pointer-words with 1s */
     dPWords = GGGGC_DESCRIPTOR_WORDS_REQ(size);
 #ifdef alloca
-    pointers = (ggc_size_t *)
-        alloca(sizeof(ggc_size_t) * dPWords);
-#else
-    pointers = (ggc_size_t *)
-        malloc(sizeof(ggc_size_t) * dPWords);
-    if (!pointers) abort();
+    if (dPWords <= PA_ALLOCA_WORDS)
+        pointers = (ggc_size_t *)
+            alloca(sizeof(ggc_size_t) * dPWords);
+    else
 #endif
+    {
+        /* too big for the stack */
+        pointers = (ggc_size_t *)
+            malloc(sizeof(ggc_size_t) * dPWords);
+        if (!pointers) abort();
+    }
     for (i = 0; i < dPWords; i++) pointers[i] = (ggc_size_t) -1;
 
     /* get rid of non-pointers */
@@ -406,9 +513,10 @@ struct GGGGC_Descriptor *ggggc_allocateDescriptorPA(ggc_size_t size)
 
     /* and allocate */
     ret = ggggc_allocateDescriptorL(size, pointers);
-#ifndef alloca
-    free(pointers);
+#ifdef alloca
+    if (dPWords > PA_ALLOCA_WORDS)
 #endif
+        free(pointers);
     return ret;
 }
 
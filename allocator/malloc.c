@@ -51,3 +51,45 @@ static void *allocPool(int mustSucceed)
 
     return ret;
 }
+
+/* allocate a span of several pools, aligned like a pool. The unaligned
+ * allocation is remembered just past the end of the span, to free it */
+static void *allocSpan(ggc_size_t size, int mustSucceed)
+{
+    unsigned char *space, *aspace;
+
+    space = (unsigned char *) malloc(size + GGGGC_POOL_BYTES + sizeof(void *));
+    if (!space) {
+        if (mustSucceed) {
+            perror("malloc");
+            abort();
+        }
+        return NULL;
+    }
+
+    /* align it */
+    aspace = (unsigned char *) GGGGC_POOL_OF(space + GGGGC_POOL_BYTES - 1);
+    *((void **) (aspace + size)) = space;
+
+    return aspace;
+}
+
+/* return a span to the system. Returns 0 if it can't be, and must be reused
+ * as pools */
+static int freeSpan(void *span, ggc_size_t size)
+{
+    free(*((void **) ((unsigned char *) span + size)));
+    return 1;
+}
+
+/* give the memory of a page-aligned range back to the system, keeping its
+ * addresses. Returns 0 if it can't be (it can't with malloc) */
+static int decommitRange(void *start, ggc_size_t size)
+{
+    return 0;
+}
+
+/* make a decommitted range usable again */
+static void recommitRange(void *start, ggc_size_t size)
+{
+}
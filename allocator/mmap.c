@@ -42,3 +42,53 @@ static void *allocPool(int mustSucceed)
 
     return ret;
 }
+
+/* allocate a span of several pools, aligned like a pool */
+static void *allocSpan(ggc_size_t size, int mustSucceed)
+{
+    unsigned char *space, *aspace;
+
+    /* allocate enough space that we can align it later */
+    space = (unsigned char *) mmap(NULL, size + GGGGC_POOL_BYTES, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+    if (space == (unsigned char *) MAP_FAILED) {
+        if (mustSucceed) {
+            perror("mmap");
+            abort();
+        }
+        return NULL;
+    }
+
+    /* align it */
+    aspace = (unsigned char *) GGGGC_POOL_OF(space + GGGGC_POOL_BYTES - 1);
+
+    /* free unused space */
+    if (aspace > space)
+        munmap(space, aspace - space);
+    munmap(aspace + size, space + GGGGC_POOL_BYTES - aspace);
+
+    return aspace;
+}
+
+/* return a span to the system. Returns 0 if it can't be, and must be reused
+ * as pools */
+static int freeSpan(void *span, ggc_size_t size)
+{
+    munmap(span, size);
+    return 1;
+}
+
+/* give the memory of a page-aligned range back to the system, keeping its
+ * addresses. Returns 0 if it can't be */
+static int decommitRange(void *start, ggc_size_t size)
+{
+#ifdef MADV_DONTNEED
+    return !madvise(start, size, MADV_DONTNEED);
+#else
+    return 0;
+#endif
+}
+
+/* make a decommitted range usable again (touching it is enough) */
+static void recommitRange(void *start, ggc_size_t size)
+{
+}
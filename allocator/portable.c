@@ -25,3 +25,34 @@ static void *allocPool(int mustSucceed)
     }
     return ret;
 }
+
+/* allocate a span of several pools */
+static void *allocSpan(ggc_size_t size, int mustSucceed)
+{
+    void *ret = malloc(size);
+    if (!ret && mustSucceed) {
+        perror("malloc");
+        abort();
+    }
+    return ret;
+}
+
+/* return a span to the system. Returns 0 if it can't be, and must be reused
+ * as pools */
+static int freeSpan(void *span, ggc_size_t size)
+{
+    free(span);
+    return 1;
+}
+
+/* give the memory of a page-aligned range back to the system, keeping its
+ * addresses. Returns 0 if it can't be (it can't with malloc) */
+static int decommitRange(void *start, ggc_size_t size)
+{
+    return 0;
+}
+
+/* make a decommitted range usable again */
+static void recommitRange(void *start, ggc_size_t size)
+{
+}
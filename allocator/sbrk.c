@@ -84,3 +84,53 @@ static void *allocPool(int mustSucceed)
     }
     return ret;
 }
+
+/* allocate a span of several pools, aligned like a pool */
+static void *allocSpan(ggc_size_t size, int mustSucceed)
+{
+    void *ret;
+    size_t offset;
+
+    mallocBump();
+
+    offset = poolOffset();
+    if (offset != 0) {
+        /* align manually */
+        fprintf(stderr, "WARNING: Wasting %d bytes\n", (int) offset);
+        sbrk(offset);
+    }
+
+    ret = sbrk(size);
+    if (ret == (void *) -1) {
+        if (mustSucceed) {
+            perror("sbrk");
+            abort();
+        } else {
+            return NULL;
+        }
+    }
+    return ret;
+}
+
+/* return a span to the system. Returns 0 if it can't be, and must be reused
+ * as pools */
+static int freeSpan(void *span, ggc_size_t size)
+{
+    return 0;
+}
+
+/* give the memory of a page-aligned range back to the system, keeping its
+ * addresses. Returns 0 if it can't be */
+static int decommitRange(void *start, ggc_size_t size)
+{
+#ifdef MADV_DONTNEED
+    return !madvise(start, size, MADV_DONTNEED);
+#else
+    return 0;
+#endif
+}
+
+/* make a decommitted range usable again (touching it is enough) */
+static void recommitRange(void *start, ggc_size_t size)
+{
+}
@@ -43,3 +43,53 @@ static void *allocPool(int mustSucceed)
 
     return ret;
 }
+
+/* allocate a span of several pools, aligned like a pool */
+static void *allocSpan(ggc_size_t size, int mustSucceed)
+{
+    unsigned char *space, *aspace;
+
+    /* find enough address space that we can align it, then take just the
+     * aligned part of it */
+    space = (unsigned char *)
+        VirtualAlloc(NULL, size + GGGGC_POOL_BYTES, MEM_RESERVE, PAGE_NOACCESS);
+    if (space != NULL) {
+        aspace = (unsigned char *) GGGGC_POOL_OF(space + GGGGC_POOL_BYTES - 1);
+        VirtualFree(space, 0, MEM_RELEASE);
+        space = (unsigned char *)
+            VirtualAlloc(aspace, size, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+    }
+    if (space == NULL) {
+        if (mustSucceed) {
+            perror("VirtualAlloc");
+            abort();
+        }
+        return NULL;
+    }
+
+    return space;
+}
+
+/* return a span to the system. Returns 0 if it can't be, and must be reused
+ * as pools */
+static int freeSpan(void *span, ggc_size_t size)
+{
+    VirtualFree(span, 0, MEM_RELEASE);
+    return 1;
+}
+
+/* give the memory of a page-aligned range back to the system, keeping its
+ * addresses. Returns 0 if it can't be */
+static int decommitRange(void *start, ggc_size_t size)
+{
+    return !!VirtualFree(start, size, MEM_DECOMMIT);
+}
+
+/* make a decommitted range usable again */
+static void recommitRange(void *start, ggc_size_t size)
+{
+    if (VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE) == NULL) {
+        perror("VirtualAlloc");
+        abort();
+    }
+}
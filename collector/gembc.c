@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/types.h>
 
 #include "ggggc-internals.h"
@@ -32,23 +33,87 @@ extern "C" {
 #endif
 
 /* create a GC pool */
-struct GGGGC_Pool *ggggc_newPoolGen(unsigned char gen, int mustSucceed)
+#if GGGGC_GENERATIONS > 1
+/* the number of cards in each group of the remembered set summary */
+#define SUMMARY_CARDS \
+    ((GGGGC_CARDS_PER_POOL < GGGGC_CARDS_PER_SUMMARY) ? \
+     GGGGC_CARDS_PER_POOL : GGGGC_CARDS_PER_SUMMARY)
+
+/* remember a card of a pool, as the write barrier does */
+#define REMEMBER_CARD(pool, card) do { \
+    (pool)->remember[card] = 1; \
+    (pool)->rememberSummary[(card) / GGGGC_CARDS_PER_SUMMARY] = 1; \
+} while (0)
+
+/* forget every remembered card of a pool, touching only the groups that have
+ * any */
+static void clearRemembered(struct GGGGC_Pool *pool)
 {
-    struct GGGGC_Pool *ret = ggggc_newPool(mustSucceed);
-    if (!ret) return ret;
+    ggc_size_t i;
+    for (i = 0; i < GGGGC_SUMMARIES_PER_POOL; i++) {
+        if (pool->rememberSummary[i]) {
+            memset(pool->remember + i * GGGGC_CARDS_PER_SUMMARY, 0, SUMMARY_CARDS);
+            pool->rememberSummary[i] = 0;
+        }
+    }
+}
+#endif
+
+#ifdef GGGGC_SURVIVOR_SPACES
+/* Survivor spaces. Rather than promoting everything that survives a nursery
+ * collection, objects are copied between survivor pools until they've survived
+ * tenuringThreshold collections. Every survivor pool holds objects of only one
+ * age, so an object's age is its pool's. Survivor pools are in generation 0,
+ * so the write barrier ignores them, but they're shared by all threads. */
+static struct GGGGC_Pool *survivorPools; /* survivors of the last collection */
+static struct GGGGC_Pool *survivorToPools; /* survivors of this collection */
+static struct GGGGC_Pool *survivorCur[GGGGC_TENURING_THRESHOLD + 1];
+static unsigned char tenuringThreshold = GGGGC_TENURING_THRESHOLD;
+#endif
+
+/* set up a new pool's collector state */
+static void poolInit(struct GGGGC_Pool *ret, unsigned char gen)
+{
+    ret->large = 0;
+    ret->survivors = 0;
 
 #if GGGGC_GENERATIONS > 1
     ret->gen = gen;
     
     /* clear the remembered set */
-    if (gen > 0)
+    if (gen > 0) {
         memset(ret->remember, 0, GGGGC_CARDS_PER_POOL);
+        memset(ret->rememberSummary, 0, GGGGC_SUMMARIES_PER_POOL);
+#ifdef GGGGC_SLOT_LOGGING
+        memset(ret->loggedBits, 0, sizeof(ret->loggedBits));
+#endif
+    }
 
     /* the first object in the first usable card */
     ret->firstObject[GGGGC_CARD_OF(ret->start)] =
         (((ggc_size_t) ret->start) & GGGGC_CARD_INNER_MASK) / sizeof(ggc_size_t);
 #endif
 
+#ifdef GGGGC_SURVIVOR_SPACES
+    /* not a survivor pool (yet) */
+    ret->age = ret->toSpace = 0;
+    ret->promoteStart = ret->start;
+#endif
+
+    /* nothing here is marked */
+    memset(ret->markBits, 0, sizeof(ret->markBits));
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+    /* anything allocated here is new to any ongoing marking */
+    ret->markTop = ret->start;
+#endif
+}
+
+struct GGGGC_Pool *ggggc_newPoolGen(unsigned char gen, int mustSucceed)
+{
+    struct GGGGC_Pool *ret = ggggc_newPool(mustSucceed);
+    if (!ret) return ret;
+    poolInit(ret, gen);
     return ret;
 }
 
@@ -61,6 +126,67 @@ static struct GGGGC_Pool *newPoolGenProto(struct GGGGC_Pool *proto) {
 #endif
 }
 
+/* Large objects. Every object of at least GGGGC_LARGE_OBJECT_WORDS words gets
+ * a large pool of its own, spanning as many pools as it needs, in the oldest
+ * generation. Large objects are traced where they are and never moved, and
+ * the full collection that finds one dead frees its pool. The write barrier
+ * remembers a large object by the card of its start, wherever the write was. */
+static struct GGGGC_Pool *largePools;
+static ggc_mutex_t largePoolsLock = GGC_MUTEX_INITIALIZER;
+
+/* words of large objects allocated since the last full collection, and that
+ * survived it */
+static ggc_size_t largeAllocated, largeLive;
+
+/* large objects are only freed by full collections, so one is run when more
+ * words of them have been allocated since the last than survived it (or than
+ * this many) */
+#define LARGE_MINIMUM_WORDS (GGGGC_WORDS_PER_POOL * 4)
+
+/* allocate a large object */
+static void *mallocLarge(struct GGGGC_Descriptor **descriptor, ggc_size_t size)
+{
+    struct GGGGC_Pool *pool;
+    struct GGGGC_Header *ret;
+    ggc_size_t limit = (largeLive > LARGE_MINIMUM_WORDS) ? largeLive : LARGE_MINIMUM_WORDS;
+
+    if (largeAllocated && largeAllocated + size > limit) {
+        GGC_PUSH_1(*descriptor);
+        ggggc_collect0(GGGGC_GENERATIONS - 1);
+        GGC_POP();
+    }
+
+    pool = ggggc_newLargePool(size, 1);
+    poolInit(pool, GGGGC_GENERATIONS - 1);
+    pool->large = 1;
+#ifdef GGGGC_BREAK_TABLE_COMPACTION
+    pool->breakTableSize = 0;
+#else
+    /* so that its object's compacted location is where it already is */
+    memset(pool->compactOffsets, 0, sizeof(pool->compactOffsets));
+#endif
+
+    ret = (struct GGGGC_Header *) pool->start;
+    memset(ret, 0, size * sizeof(ggc_size_t));
+#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
+    ret->ggggc_memoryCorruptionCheck = GGGGC_MEMORY_CORRUPTION_VAL;
+#endif
+
+#if GGGGC_GENERATIONS > 1
+    /* the descriptor it's about to be given may be young */
+    if (*descriptor && GGGGC_POOL_OF(*descriptor)->gen < pool->gen)
+        REMEMBER_CARD(pool, GGGGC_CARD_OF(ret));
+#endif
+
+    ggc_mutex_lock_raw(&largePoolsLock);
+    pool->next = largePools;
+    largePools = pool;
+    largeAllocated += size;
+    ggc_mutex_unlock(&largePoolsLock);
+
+    return ret;
+}
+
 /* NOTE: there is code duplication between ggggc_malloc and ggggc_mallocGen1
  * because I can't trust a compiler to inline and optimize for the 0 case */
 
@@ -71,6 +197,9 @@ void *ggggc_mallocRaw(struct GGGGC_Descriptor **descriptor, /* descriptor to pro
     struct GGGGC_Pool *pool;
     struct GGGGC_Header *ret;
 
+    if (size >= GGGGC_LARGE_OBJECT_WORDS)
+        return mallocLarge(descriptor, size);
+
 retry:
     /* get our allocation pool */
     if (ggggc_pool0) {
@@ -167,6 +296,82 @@ void *ggggc_malloc(struct GGGGC_Descriptor *descriptor)
     return ret;
 }
 
+#if GGGGC_GENERATIONS > 1
+/* mutators allocating in the old generation share its pools */
+static ggc_mutex_t oldAllocLock = GGC_MUTEX_INITIALIZER;
+#endif
+
+/* allocate an object directly in the old generation */
+void *ggggc_mallocOld(struct GGGGC_Descriptor *descriptor)
+{
+#if GGGGC_GENERATIONS > 1
+    struct GGGGC_Header *ret;
+    struct GGGGC_Pool *pool;
+    ggc_size_t size = descriptor->size;
+
+    /* large objects are always allocated old */
+    if (size >= GGGGC_LARGE_OBJECT_WORDS)
+        return ggggc_malloc(descriptor);
+
+    ggc_mutex_lock_raw(&oldAllocLock);
+    ret = (struct GGGGC_Header *) ggggc_mallocGen1(size, 1);
+    ggc_mutex_unlock(&oldAllocLock);
+
+    if (ret) {
+        memset(ret, 0, size * sizeof(ggc_size_t));
+#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
+        ret->ggggc_memoryCorruptionCheck = GGGGC_MEMORY_CORRUPTION_VAL;
+#endif
+        ret->descriptor__ptr = descriptor;
+
+        /* the descriptor is a pointer like any other, and may be young */
+        pool = GGGGC_POOL_OF(ret);
+        if (GGGGC_POOL_OF(descriptor)->gen < pool->gen)
+            GGGGC_WP_REMEMBER(pool, ret, &ret->descriptor__ptr);
+        return ret;
+    }
+#endif
+
+    /* the old generation is full (the next collection will grow it), or
+     * there isn't one */
+    return ggggc_malloc(descriptor);
+}
+
+/* allocation sites that have allocated, for survival feedback */
+static struct GGGGC_AllocSite *allocSites;
+static ggc_mutex_t allocSitesLock = GGC_MUTEX_INITIALIZER;
+
+/* allocate an object from an allocation site */
+void *ggggc_mallocSite(struct GGGGC_AllocSite *site, struct GGGGC_Descriptor *descriptor)
+{
+    struct GGGGC_Header *ret;
+    ggc_size_t i;
+
+    if (site->old)
+        return ggggc_mallocOld(descriptor);
+
+    ret = (struct GGGGC_Header *) ggggc_malloc(descriptor);
+
+    if (!site->registered) {
+        ggc_mutex_lock_raw(&allocSitesLock);
+        if (!site->registered) {
+            site->next = allocSites;
+            allocSites = site;
+            site->registered = 1;
+        }
+        ggc_mutex_unlock(&allocSitesLock);
+    }
+
+    /* probe the first few objects since the last collection, since they've
+     * had the longest to die. Racing threads can only lose a sample. */
+    i = site->allocated;
+    if (i < GGGGC_SITE_PROBES)
+        site->probes[i] = ret;
+    site->allocated = i + 1;
+
+    return ret;
+}
+
 
 /* full collection */
 #ifdef GGGGC_FEATURE_FINALIZERS
@@ -181,9 +386,11 @@ void *ggggc_malloc(struct GGGGC_Descriptor *descriptor)
 void ggggc_collectFull(COLLECT_FULL_ARGS);
 
 /* helper functions for full collection */
+#ifdef GGGGC_BREAK_TABLE_COMPACTION
 void ggggc_countUsed(struct GGGGC_Pool *);
 void ggggc_compact(struct GGGGC_Pool *);
 void ggggc_postCompact(struct GGGGC_Pool *);
+#endif
 
 /* follow a forwarding pointer to the object it actually represents */
 #define IS_FORWARDED_OBJECT(obj) (((ggc_size_t) (obj)->descriptor__ptr) & 1)
@@ -210,9 +417,9 @@ void ggggc_postCompact(struct GGGGC_Pool *);
 #define IS_TAGGED(p) 0
 #endif
 
-/* macro to add an object's pointers to the tosearch list */
+/* macro to add an object's pointers to a list, using the given ADD macro */
 #ifndef GGGGC_FEATURE_EXTTAG
-#define ADD_OBJECT_POINTERS(obj, descriptor) do { \
+#define SCAN_OBJECT_POINTERS(obj, descriptor, ADD) do { \
     void **objVp = (void **) (obj); \
     ggc_size_t curWord, curDescription, curDescriptorWord = 0; \
     if (descriptor->pointers[0] & 1) { \
@@ -224,15 +431,15 @@ void ggggc_postCompact(struct GGGGC_Pool *);
             if (curDescription & 1) \
                 /* it's a pointer */ \
                 if (objVp[curWord] && !IS_TAGGED(objVp[curWord])) \
-                    TOSEARCH_ADD(&objVp[curWord]); \
+                    ADD(&objVp[curWord]); \
             curDescription >>= 1; \
         } \
     } \
-    TOSEARCH_ADD(&objVp[0]); \
+    ADD(&objVp[0]); \
 } while(0)
 
 #else /* !GGGGC_FEATURE_EXTTAG */
-#define ADD_OBJECT_POINTERS(obj, descriptor) do { \
+#define SCAN_OBJECT_POINTERS(obj, descriptor, ADD) do { \
     void **objVp = (void **) (obj); \
     ggc_size_t curWord; \
     if (descriptor->tags[0] != 1) { \
@@ -240,15 +447,224 @@ void ggggc_postCompact(struct GGGGC_Pool *);
         for (curWord = 1; curWord < descriptor->size; curWord++) { \
             if ((descriptor->tags[curWord] & 1) == 0) \
                 /* it's a pointer */ \
-                TOSEARCH_ADD(&objVp[curWord]); \
+                ADD(&objVp[curWord]); \
         } \
     } \
-    TOSEARCH_ADD(&objVp[0]); \
+    ADD(&objVp[0]); \
 } while (0)
 
 #endif /* GGGGC_FEATURE_EXTTAG */
 
-static struct ToSearch toSearchList;
+/* Parallel collection. While the world is stopped, the mutator threads which
+ * would otherwise just be waiting in ggggc_yield act as collector workers. The
+ * collecting thread is always worker 0. */
+static ggc_size_t workerCount;
+static void (*volatile workerPhase)(ggc_size_t workerId);
+
+/* run a phase of collection on every worker, returning when all are done */
+static void runParallel(void (*phase)(ggc_size_t))
+{
+#ifndef GGGGC_NO_PARALLEL_COLLECTION
+    workerPhase = phase;
+    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+    phase(0);
+    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+#else
+    phase(0);
+#endif
+}
+
+/* participate in collection phases until the collector releases us */
+static void workParallel(ggc_size_t workerId)
+{
+#ifndef GGGGC_NO_PARALLEL_COLLECTION
+    void (*phase)(ggc_size_t);
+    while (1) {
+        ggc_barrier_wait_raw(&ggggc_worldBarrier);
+        phase = workerPhase;
+        if (!phase) break;
+        phase(workerId);
+        ggc_barrier_wait_raw(&ggggc_worldBarrier);
+    }
+#else
+    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+#endif
+}
+
+/* Work-stealing stacks, for marking and evacuation. Each worker pushes to and
+ * pops from a private segment. When that segment fills, it's shared, and
+ * workers that run out of work steal shared segments from each other. */
+#define WORK_SEGMENT_SZ 1024
+
+/* objects with more words than this are marked in chunks, so that one large
+ * array can be split between workers */
+#define MARK_CHUNK_WORDS 4096
+
+struct WorkSegment {
+    struct WorkSegment *next;
+    ggc_size_t used;
+    void *buf[WORK_SEGMENT_SZ];
+};
+
+#if GGGGC_GENERATIONS > 1
+/* a space that a worker evacuates objects into */
+struct EvacuationBuffer {
+    struct GGGGC_Pool *pool;
+    ggc_size_t *free, *end;
+};
+#endif
+
+struct Worker {
+    ggc_mutex_t lock; /* protects shared */
+    struct WorkSegment *cur, *volatile shared, *spare;
+
+#if GGGGC_GENERATIONS > 1
+    /* this worker's promotion buffer */
+    struct EvacuationBuffer promotion;
+
+#ifdef GGGGC_SURVIVOR_SPACES
+    /* and its survivor space buffers, by age */
+    struct EvacuationBuffer survivor[GGGGC_TENURING_THRESHOLD + 1];
+#endif
+#endif
+};
+
+static struct Worker **workers;
+static ggc_size_t workersCount;
+
+/* number of workers which currently have (or are stealing) work */
+static volatile ggc_size_t workActive;
+
+/* get an empty segment for this worker */
+static struct WorkSegment *workSegment(struct Worker *w)
+{
+    struct WorkSegment *seg = w->spare;
+    if (seg) {
+        w->spare = seg->next;
+    } else {
+        seg = (struct WorkSegment *) malloc(sizeof(struct WorkSegment));
+        if (seg == NULL) {
+            perror("malloc");
+            abort();
+        }
+    }
+    seg->next = NULL;
+    seg->used = 0;
+    return seg;
+}
+
+/* make sure every worker has a work stack */
+static void workersInit()
+{
+    static ggc_mutex_t lockInit = GGC_MUTEX_INITIALIZER;
+    ggc_size_t i;
+
+    if (workersCount >= workerCount) return;
+
+    workers = (struct Worker **)
+        realloc(workers, workerCount * sizeof(struct Worker *));
+    if (workers == NULL) {
+        perror("realloc");
+        abort();
+    }
+    for (i = workersCount; i < workerCount; i++) {
+        struct Worker *w = (struct Worker *) malloc(sizeof(struct Worker));
+        if (w == NULL) {
+            perror("malloc");
+            abort();
+        }
+        w->lock = lockInit;
+        w->shared = w->spare = NULL;
+#if GGGGC_GENERATIONS > 1
+        memset(&w->promotion, 0, sizeof(w->promotion));
+#ifdef GGGGC_SURVIVOR_SPACES
+        memset(w->survivor, 0, sizeof(w->survivor));
+#endif
+#endif
+        w->cur = workSegment(w);
+        workers[i] = w;
+    }
+    workersCount = workerCount;
+}
+
+/* share this worker's (full) current segment, and start a new one */
+static void workShare(struct Worker *w)
+{
+    struct WorkSegment *seg = w->cur;
+    w->cur = workSegment(w);
+    ggc_mutex_lock_raw(&w->lock);
+    seg->next = w->shared;
+    w->shared = seg;
+    ggc_mutex_unlock(&w->lock);
+}
+
+/* take a shared segment from victim (possibly w itself) to replace w's empty
+ * current segment */
+static int workTake(struct Worker *w, struct Worker *victim)
+{
+    struct WorkSegment *seg;
+
+    if (!victim->shared) return 0;
+    ggc_mutex_lock_raw(&victim->lock);
+    seg = victim->shared;
+    if (seg) victim->shared = seg->next;
+    ggc_mutex_unlock(&victim->lock);
+    if (!seg) return 0;
+
+    w->cur->next = w->spare;
+    w->spare = w->cur;
+    w->cur = seg;
+    return 1;
+}
+
+#define WORK_PUSH(w, ptr) do { \
+    if ((w)->cur->used >= WORK_SEGMENT_SZ) workShare(w); \
+    (w)->cur->buf[(w)->cur->used++] = (ptr); \
+} while(0)
+
+/* push a chunk of a large object, as a tagged object pointer over the index of
+ * the first word of the chunk. The pair must stay in one segment. */
+#define WORK_PUSH_CHUNK(w, obj, from) do { \
+    if ((w)->cur->used >= WORK_SEGMENT_SZ - 1) workShare(w); \
+    (w)->cur->buf[(w)->cur->used++] = (void *) (ggc_size_t) (from); \
+    (w)->cur->buf[(w)->cur->used++] = (void *) ((ggc_size_t) (obj) | 1); \
+} while(0)
+
+/* get the next entry to process, stealing if we're out of work. Returns 0 only
+ * when every worker is out of work. */
+static int workNext(ggc_size_t workerId, void **into)
+{
+    struct Worker *w = workers[workerId];
+    ggc_size_t i;
+
+    if (w->cur->used || workTake(w, w)) goto pop;
+
+    /* we're out of work */
+    GGGGC_ATOMIC_SUB(&workActive, 1);
+    while (1) {
+        for (i = 1; i < workerCount; i++) {
+            struct Worker *victim = workers[(workerId + i) % workerCount];
+            if (victim->shared) {
+                GGGGC_ATOMIC_ADD(&workActive, 1);
+                if (workTake(w, victim)) goto pop;
+                GGGGC_ATOMIC_SUB(&workActive, 1);
+            }
+        }
+
+        /* only active workers can share more work, so if there are none and
+         * nothing is shared, we're done */
+        GGGGC_MEMORY_BARRIER();
+        if (workActive == 0) {
+            for (i = 0; i < workerCount && !workers[i]->shared; i++);
+            if (i == workerCount) return 0;
+        }
+        ggc_thread_yield();
+    }
+
+pop:
+    *into = w->cur->buf[--w->cur->used];
+    return 1;
+}
 
 #ifdef GGGGC_FEATURE_FINALIZERS
 /* macro to handle the finalizers for a given pool */
@@ -362,6 +778,19 @@ static void memoryCorruptionCheck(const char *when)
         }
     }
 
+#ifdef GGGGC_SURVIVOR_SPACES
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+        struct GGGGC_Header *obj = (struct GGGGC_Header *) poolCur->start;
+        for (; obj < (struct GGGGC_Header *) poolCur->free;
+             obj = (struct GGGGC_Header *) (((ggc_size_t) obj) + obj->descriptor__ptr->size * sizeof(ggc_size_t))) {
+            memoryCorruptionCheckObj(when, obj);
+        }
+    }
+#endif
+
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+        memoryCorruptionCheckObj(when, (struct GGGGC_Header *) poolCur->start);
+
     for (pslCur = ggggc_rootPointerStackList; pslCur; pslCur = pslCur->next) {
         for (psCur = pslCur->pointerStack; psCur; psCur = psCur->next) {
             ggc_size_t i;
@@ -402,115 +831,361 @@ static void report(unsigned char gen, const char *when)
         }
         fprintf(stderr, " %d: %d/%d\n", (int) genCur, (int) used, (int) sz);
     }
+
+#ifdef GGGGC_SURVIVOR_SPACES
+    sz = used = 0;
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+        sz += poolCur->end - poolCur->start;
+        used += poolCur->free - poolCur->start;
+    }
+    fprintf(stderr, " survivors: %d/%d (tenuring threshold %d)\n",
+            (int) used, (int) sz, (int) tenuringThreshold);
+#endif
+
+    used = 0;
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+        used += poolCur->free - poolCur->start;
+    fprintf(stderr, " large: %d\n", (int) used);
 }
 #endif
 
-/* run a generation 0 collection */
-void ggggc_collect0(unsigned char gen)
+#if defined(GGGGC_SNAPSHOT_MARKING) || defined(GGGGC_SLOT_LOGGING)
+/* Logs made by the write barrier. Each thread fills its own buffer, and hands
+ * it over to the collector when it's full or the thread stops. */
+#define LOG_BUFFER_SZ 1024
+struct LogBuffer {
+    struct LogBuffer *next;
+    ggc_size_t used;
+    void *buf[LOG_BUFFER_SZ];
+};
+
+/* hand a thread's buffer over to a full list */
+static void logFlush(struct LogBuffer **local, struct LogBuffer **full,
+                     ggc_mutex_t *lock)
 {
-    struct GGGGC_PoolList pool0Node, *plCur;
-    struct GGGGC_Pool *poolCur;
-    struct GGGGC_PointerStackList pointerStackNode, *pslCur;
-    struct GGGGC_PointerStack *psCur;
-    struct ToSearch *toSearch;
-    unsigned char genCur;
-    ggc_size_t i;
-#ifdef GGGGC_FEATURE_JITPSTACK
-    struct GGGGC_JITPointerStackList jitPointerStackNode, *jpslCur;
-    void **jpsCur;
-#endif
-#ifdef GGGGC_FEATURE_FINALIZERS
-    int finalizersChecked;
-    GGGGC_FinalizerEntry survivingFinalizers, survivingFinalizersTail, readyFinalizers;
-    survivingFinalizers = survivingFinalizersTail = readyFinalizers = NULL;
-#endif
+    struct LogBuffer *buf = *local;
+    if (!buf) return;
+    *local = NULL;
 
-    /* first, make sure we stop the world */
-    while (ggc_mutex_trylock(&ggggc_worldBarrierLock) != 0) {
-        /* somebody else is collecting */
-        GGC_YIELD();
+    if (buf->used == 0) {
+        free(buf);
+        return;
     }
 
-    TOSEARCH_INIT();
+    ggc_mutex_lock_raw(lock);
+    buf->next = *full;
+    *full = buf;
+    ggc_mutex_unlock(lock);
+}
 
-    /* if nobody ever initialized the barrier, do so */
-    if (ggggc_threadCount == (ggc_size_t) -1) {
-        ggggc_threadCount = 1;
-        ggc_barrier_init(&ggggc_worldBarrier, ggggc_threadCount);
-    }
+/* add an entry to a thread's buffer */
+static void logAdd(struct LogBuffer **local, struct LogBuffer **full,
+                   ggc_mutex_t *lock, void *ptr)
+{
+    struct LogBuffer *buf = *local;
 
-    /* initialize our roots */
-    ggc_mutex_lock_raw(&ggggc_rootsLock);
-    pool0Node.pool = ggggc_gen0;
-    pool0Node.next = ggggc_blockedThreadPool0s;
-    ggggc_rootPool0List = &pool0Node;
-    pointerStackNode.pointerStack = ggggc_pointerStack;
-    pointerStackNode.next = ggggc_blockedThreadPointerStacks;
-    ggggc_rootPointerStackList = &pointerStackNode;
+    if (!buf || buf->used == LOG_BUFFER_SZ) {
+        logFlush(local, full, lock);
+        buf = (struct LogBuffer *) malloc(sizeof(struct LogBuffer));
+        if (buf == NULL) {
+            perror("malloc");
+            abort();
+        }
+        buf->used = 0;
+        *local = buf;
+    }
 
-#ifdef GGGGC_FEATURE_JITPSTACK
-    jitPointerStackNode.cur = ggc_jitPointerStack;
-    jitPointerStackNode.top = ggc_jitPointerStackEnd;
-    jitPointerStackNode.next = ggggc_blockedThreadJITPointerStacks;
-    ggggc_rootJITPointerStackList = &jitPointerStackNode;
+    buf->buf[buf->used++] = ptr;
+}
 #endif
 
-    ggc_mutex_unlock(&ggggc_rootsLock);
+#ifdef GGGGC_SLOT_LOGGING
+/* Slot logging. Instead of marking cards, the write barrier logs each pointer
+ * slot of an old object the first time it's written to, and sets its bit in
+ * its pool's loggedBits so that it isn't logged again. The logged slots are
+ * the remembered set of the next nursery collection, along with any cards that
+ * compaction remembered. */
+static ggc_thread_local struct LogBuffer *slotLogBuffer;
+static struct LogBuffer *slotLogFull;
+static ggc_mutex_t slotLogLock = GGC_MUTEX_INITIALIZER;
+
+#define LOGGED_WORD(slot) \
+    (((ggc_size_t) (slot) & GGGGC_POOL_INNER_MASK) / sizeof(ggc_size_t))
+#define LOGGED_BIT(slot) \
+    ((ggc_size_t) 1 << (LOGGED_WORD(slot) % GGGGC_BITS_PER_WORD))
+#define LOGGED_BITS(slot) \
+    (GGGGC_POOL_OF(slot)->loggedBits[LOGGED_WORD(slot) / GGGGC_BITS_PER_WORD])
+
+/* log a slot of an old object which is being written to */
+void ggggc_slotLog(void *object, void *slot)
+{
+    struct GGGGC_Pool *pool = GGGGC_POOL_OF(object);
 
-    /* stop the world */
-    ggggc_stopTheWorld = 1;
-    ggc_barrier_wait_raw(&ggggc_worldBarrier);
-    ggggc_stopTheWorld = 0;
+    /* a large pool's slots outnumber its logged bits, so it's remembered by
+     * card instead */
+    if (pool->large) {
+        REMEMBER_CARD(pool, GGGGC_CARD_OF(object));
+        return;
+    }
 
-    /* wait for them to fill roots */
-    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+    /* other threads may be setting bits in the same word, but if we lose
+     * their update, they'll only log their slot again */
+    LOGGED_BITS(slot) |= LOGGED_BIT(slot);
+    logAdd(&slotLogBuffer, &slotLogFull, &slotLogLock, slot);
+}
 
-#ifdef GGGGC_DEBUG_REPORT_COLLECTIONS
-    report(gen, "pre-collection");
-#endif
+/* hand this thread's log to the collector */
+void ggggc_slotLogFlush()
+{
+    logFlush(&slotLogBuffer, &slotLogFull, &slotLogLock);
+}
 
-#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
-    memoryCorruptionCheck("pre-collection");
+/* after a nursery collection of generations up to gen, forget the logged
+ * slots which can no longer point to anything younger */
+static void slotLogFilter(unsigned char gen)
+{
+    struct LogBuffer *buf, **prev = &slotLogFull;
+    ggc_size_t i, kept;
+
+    while ((buf = *prev)) {
+        kept = 0;
+        for (i = 0; i < buf->used; i++) {
+            void **slot = (void **) buf->buf[i];
+            unsigned char slotGen = GGGGC_POOL_OF(slot)->gen;
+            if (slotGen > gen + 1
+#ifdef GGGGC_SURVIVOR_SPACES
+                /* or it points into the survivor spaces */
+                || (slotGen == gen + 1 && *slot && !IS_TAGGED(*slot) &&
+                    GGGGC_GEN_OF(*slot) == 0)
 #endif
+                )
+                buf->buf[kept++] = slot;
+            else
+                LOGGED_BITS(slot) &= ~LOGGED_BIT(slot);
+        }
+        buf->used = kept;
 
-    /************************************************************
-     * COLLECTION
-     ***********************************************************/
-collect:
+        if (kept == 0) {
+            *prev = buf->next;
+            free(buf);
+        } else {
+            prev = &buf->next;
+        }
+    }
+}
+#endif
 
-    /* possibly jump to a full collection */
-    if (
 #if GGGGC_GENERATIONS > 1
-        gen >= GGGGC_GENERATIONS - 1
-#else
-        1
-#endif
-    ) {
-        ggggc_collectFull(
-#ifdef GGGGC_FEATURE_FINALIZERS
-            &survivingFinalizers, &survivingFinalizersTail, &readyFinalizers
+/* state of the current evacuation, shared by all workers */
+static unsigned char evacuateGen;
+static volatile int promotionFailed;
+
+/* promotion allocates from the shared generation pools */
+static ggc_mutex_t promotionLock = GGC_MUTEX_INITIALIZER;
+
+/* Promotion buffers. Each worker promotes into its own buffer, carved out of
+ * the target generation. Buffers end on card boundaries, so the firstObject
+ * entries of the cards inside a buffer belong to its worker alone. */
+#define PROMOTION_BUFFER_WORDS (4 * GGGGC_CARD_BYTES / sizeof(ggc_size_t))
+
+/* the size of the smallest filler object */
+#define FILLER_WORDS GGGGC_WORD_SIZEOF(struct GGGGC_Descriptor)
+
+/* turn unused space into a pointer-free filler object, so that the pool can
+ * still be walked. The filler is its own descriptor. */
+static void fillUnused(ggc_size_t *start, ggc_size_t size)
+{
+    struct GGGGC_Descriptor *filler = (struct GGGGC_Descriptor *) start;
+    filler->header.descriptor__ptr = filler;
+#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
+    filler->header.ggggc_memoryCorruptionCheck = GGGGC_MEMORY_CORRUPTION_VAL;
 #endif
-        );
-        goto postCollect;
+    filler->size = size;
+    filler->user__ptr = NULL;
+#ifndef GGGGC_FEATURE_EXTTAG
+    filler->pointers[0] = 0;
+#else
+    filler->tags[0] = 1;
+#endif
+}
+
+#ifdef GGGGC_SURVIVOR_SPACES
+/* start a survivor pool for objects of the given age (under promotionLock) */
+static struct GGGGC_Pool *survivorPoolNew(unsigned char age)
+{
+    struct GGGGC_Pool *pool = ggggc_newPoolGen(0, 0);
+    if (!pool) return NULL;
+    pool->age = age;
+    pool->toSpace = 1;
+    pool->survivors = 0;
+    pool->next = survivorToPools;
+    survivorToPools = survivorCur[age] = pool;
+    return pool;
+}
+#endif
+
+/* carve a new evacuation buffer with room for at least size words, from
+ * generation gen, or from the survivor space for age if age is nonzero */
+static int evacuationBufferNew(struct EvacuationBuffer *buf, ggc_size_t size,
+                               unsigned char gen, unsigned char age)
+{
+    struct GGGGC_Pool *pool;
+    ggc_size_t *end;
+
+    ggc_mutex_lock_raw(&promotionLock);
+
+retry:
+    /* get our allocation pool */
+#ifdef GGGGC_SURVIVOR_SPACES
+    if (age) {
+        /* survivor spaces grow as needed */
+        pool = survivorCur[age];
+        if (!pool || pool->end - pool->free < size)
+            pool = survivorPoolNew(age);
+        if (!pool) {
+            ggc_mutex_unlock(&promotionLock);
+            return 0;
+        }
+    } else
+#endif
+    if (ggggc_pools[gen]) {
+        pool = ggggc_pools[gen];
+    } else {
+        ggggc_gens[gen] = ggggc_pools[gen] = pool = ggggc_newPoolGen(gen, 1);
     }
 
-#if GGGGC_GENERATIONS > 1
-    /* add our roots to the to-search list */
+    /* do we have enough space? */
+    if (pool->end - pool->free >= size) {
+        /* good, carve a buffer ending on a card boundary */
+        end = (ggc_size_t *)
+            (((ggc_size_t) (pool->free + PROMOTION_BUFFER_WORDS) + GGGGC_CARD_BYTES - 1) &
+             GGGGC_CARD_OUTER_MASK);
+        if (end > pool->end) end = pool->end;
+        buf->pool = pool;
+        buf->free = pool->free;
+        buf->end = pool->free = end;
+
+        /* the next object starts at the beginning of the next card */
+        if (end < pool->end) {
+            pool->firstObject[GGGGC_CARD_OF(end)] =
+                ((ggc_size_t) end & GGGGC_CARD_INNER_MASK) / sizeof(ggc_size_t);
+            *end = 0;
+        }
+
+    } else if (!age && pool->next) {
+        ggggc_pools[gen] = pool = pool->next;
+        goto retry;
+
+    } else {
+        /* failed to allocate */
+        ggc_mutex_unlock(&promotionLock);
+        return 0;
+
+    }
+
+    ggc_mutex_unlock(&promotionLock);
+    return 1;
+}
+
+/* retire an evacuation buffer, filling its unused tail */
+static void evacuationBufferRetire(struct EvacuationBuffer *buf)
+{
+    struct GGGGC_Pool *pool = buf->pool;
+
+    if (buf->free < buf->end) {
+        if (buf->end == pool->end) {
+            /* nobody allocated after us, so give it back */
+            ggc_mutex_lock_raw(&promotionLock);
+            pool->free = buf->free;
+            *pool->free = 0;
+            ggc_mutex_unlock(&promotionLock);
+
+        } else {
+            fillUnused(buf->free, buf->end - buf->free);
+
+        }
+    }
+
+    buf->pool = NULL;
+    buf->free = buf->end = NULL;
+}
+
+/* allocate an evacuated object, preferably in this worker's buffer. It's
+ * promoted to gen, or copied to the survivor space for age if age is nonzero */
+static struct GGGGC_Header *promotionAlloc(struct Worker *w, ggc_size_t size,
+                                           unsigned char gen, unsigned char age)
+{
+    struct EvacuationBuffer *buf = &w->promotion;
+    struct GGGGC_Header *ret;
+    ggc_size_t room;
+
+    /* large objects don't go in buffers */
+    if (size > PROMOTION_BUFFER_WORDS / 2) {
+        /* nor are they aged */
+        if (age) return NULL;
+        ggc_mutex_lock_raw(&promotionLock);
+        ret = (struct GGGGC_Header *) ggggc_mallocGen1(size, gen);
+        ggc_mutex_unlock(&promotionLock);
+        return ret;
+    }
+
+#ifdef GGGGC_SURVIVOR_SPACES
+    if (age) buf = &w->survivor[age];
+#endif
+
+    /* the tail we leave must be big enough to fill, unless we can give it back */
+    room = buf->end - buf->free;
+    if (size > room ||
+        (size < room && room - size < FILLER_WORDS && buf->end != buf->pool->end)) {
+        if (buf->pool) evacuationBufferRetire(buf);
+        if (!evacuationBufferNew(buf, size, gen, age)) return NULL;
+    }
+
+    ret = (struct GGGGC_Header *) buf->free;
+    buf->free += size;
+
+    /* if we passed a card, mark the first object */
+    if (GGGGC_CARD_OF(ret) != GGGGC_CARD_OF(buf->free) && buf->free < buf->end)
+        buf->pool->firstObject[GGGGC_CARD_OF(buf->free)] =
+            ((ggc_size_t) buf->free & GGGGC_CARD_INNER_MASK) / sizeof(ggc_size_t);
+
+    return ret;
+}
+
+/* first evacuation phase: each worker finds the roots and remembered pointers
+ * in its own partition */
+static void evacuateRootsPhase(ggc_size_t workerId)
+{
+    struct Worker *w = workers[workerId];
+    struct GGGGC_Pool *poolCur;
+    struct GGGGC_PointerStackList *pslCur;
+    struct GGGGC_PointerStack *psCur;
+    unsigned char genCur;
+    ggc_size_t i, j, part = 0;
+#ifdef GGGGC_FEATURE_JITPSTACK
+    struct GGGGC_JITPointerStackList *jpslCur;
+    void **jpsCur;
+#endif
+
+#define EVACUATE_ADD(ptr) WORK_PUSH(w, ptr)
+    /* add our roots */
     for (pslCur = ggggc_rootPointerStackList; pslCur; pslCur = pslCur->next) {
+        if (part++ % workerCount != workerId) continue;
         for (psCur = pslCur->pointerStack; psCur; psCur = psCur->next) {
             for (i = 0; i < psCur->size; i++) {
                 if (psCur->pointers[i] && !IS_TAGGED(*(void **) psCur->pointers[i]))
-                    TOSEARCH_ADD(psCur->pointers[i]);
+                    WORK_PUSH(w, psCur->pointers[i]);
             }
         }
     }
 
 #ifdef GGGGC_FEATURE_JITPSTACK
     for (jpslCur = ggggc_rootJITPointerStackList; jpslCur; jpslCur = jpslCur->next) {
+        if (part++ % workerCount != workerId) continue;
         for (jpsCur = jpslCur->cur; jpsCur < jpslCur->top; jpsCur++) {
 #ifndef GGGGC_FEATURE_EXTTAG
-            if (!IS_TAGGED(*((void *) jpsCur)))
-                TOSEARCH_ADD(jpsCur);
+            if (!IS_TAGGED(*((void **) jpsCur)))
+                WORK_PUSH(w, jpsCur);
 #else
             int wordIdx;
             size_t tags = *((ggc_size_t *) jpsCur);
@@ -524,42 +1199,90 @@ collect:
                 jpsCur++;
                 /* Lowest bit indicates pointer */
                 if ((tag & 0x1) == 0 && *jpsCur)
-                    TOSEARCH_ADD(jpsCur);
+                    WORK_PUSH(w, jpsCur);
             }
 #endif /* GGGGC_FEATURE_EXTTAG */
         }
     }
 #endif /* GGGGC_FEATURE_JITPSTACK */
 
-    /* add our remembered sets to the to-search list */
-    for (genCur = gen + 1; genCur < GGGGC_GENERATIONS; genCur++) {
+    /* add our remembered sets. Only the summarized groups with remembered
+     * cards are looked at, and they're divided between the workers. */
+    for (genCur = evacuateGen + 1; genCur < GGGGC_GENERATIONS; genCur++) {
         for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-            for (i = 0; i < GGGGC_CARDS_PER_POOL; i++) {
-                if (poolCur->remember[i]) {
-                    struct GGGGC_Header *obj = (struct GGGGC_Header *)
-                        ((ggc_size_t) poolCur + i * GGGGC_CARD_BYTES + poolCur->firstObject[i] * sizeof(ggc_size_t));
-                    while (GGGGC_CARD_OF(obj) == i) {
-                        ADD_OBJECT_POINTERS(obj, obj->descriptor__ptr);
-                        obj = (struct GGGGC_Header *)
-                            ((ggc_size_t) obj + obj->descriptor__ptr->size * sizeof(ggc_size_t));
-                        if (obj->descriptor__ptr == NULL) break;
+            for (j = 0; j < GGGGC_SUMMARIES_PER_POOL; j++) {
+                if (!poolCur->rememberSummary[j]) continue;
+                if (part++ % workerCount != workerId) continue;
+                for (i = j * GGGGC_CARDS_PER_SUMMARY; i < j * GGGGC_CARDS_PER_SUMMARY + SUMMARY_CARDS; i++) {
+                    ggc_size_t cards;
+
+                    /* skip a word's worth of clean cards at a time */
+                    if (i % sizeof(ggc_size_t) == 0 &&
+                        i + sizeof(ggc_size_t) <= GGGGC_CARDS_PER_POOL) {
+                        memcpy(&cards, poolCur->remember + i, sizeof(ggc_size_t));
+                        if (!cards) {
+                            i += sizeof(ggc_size_t) - 1;
+                            continue;
+                        }
+                    }
+
+                    if (poolCur->remember[i]) {
+                        struct GGGGC_Header *obj = (struct GGGGC_Header *)
+                            ((ggc_size_t) poolCur + i * GGGGC_CARD_BYTES + poolCur->firstObject[i] * sizeof(ggc_size_t));
+                        while (GGGGC_CARD_OF(obj) == i) {
+                            SCAN_OBJECT_POINTERS(obj, obj->descriptor__ptr, EVACUATE_ADD);
+                            obj = (struct GGGGC_Header *)
+                                ((ggc_size_t) obj + obj->descriptor__ptr->size * sizeof(ggc_size_t));
+                            if (obj->descriptor__ptr == NULL) break;
+                        }
                     }
                 }
             }
         }
     }
 
-#ifdef GGGGC_FEATURE_FINALIZERS
-    /* start pre-finalizers */
-    finalizersChecked = 0;
+    /* and the remembered large objects, each as a part of its own */
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next) {
+        struct GGGGC_Header *obj = (struct GGGGC_Header *) poolCur->start;
+        if (!poolCur->remember[GGGGC_CARD_OF(obj)]) continue;
+        if (part++ % workerCount != workerId) continue;
+        SCAN_OBJECT_POINTERS(obj, obj->descriptor__ptr, EVACUATE_ADD);
+    }
+
+#ifdef GGGGC_SLOT_LOGGING
+    /* and the slots logged by the write barrier, a buffer at a time */
+    {
+        struct LogBuffer *buf;
+        for (buf = slotLogFull; buf; buf = buf->next) {
+            if (part++ % workerCount != workerId) continue;
+            for (i = 0; i < buf->used; i++) {
+                void **slot = (void **) buf->buf[i];
+                if (GGGGC_POOL_OF(slot)->gen > evacuateGen &&
+                    *slot && !IS_TAGGED(*slot))
+                    EVACUATE_ADD(slot);
+            }
+        }
+    }
 #endif
+#undef EVACUATE_ADD
+}
 
-    /* now test all our pointers */
-    while (toSearch->used) {
-        void **ptr;
+/* second evacuation phase: copy everything reachable from the work stacks */
+static void evacuatePhase(ggc_size_t workerId)
+{
+    struct Worker *w = workers[workerId];
+    struct GGGGC_Pool *pool;
+    unsigned char gen = evacuateGen;
+    void *item;
+
+#define EVACUATE_ADD(ptr) WORK_PUSH(w, ptr)
+    while (workNext(workerId, &item)) {
+        void **ptr = (void **) item;
         struct GGGGC_Header *obj;
 
-        TOSEARCH_POP(void **, ptr);
+        /* after a failure, we're just draining the work stacks */
+        if (promotionFailed) continue;
+
         obj = (struct GGGGC_Header *) *ptr;
         if (obj == NULL) continue;
 
@@ -571,6 +1294,7 @@ collect:
         }
 #endif
 
+retry:
         /* is the object already forwarded? */
         if (IS_FORWARDED_OBJECT(obj)) {
             FOLLOW_FORWARDED_OBJECT(obj);
@@ -578,257 +1302,1668 @@ collect:
         }
 
         /* does it need to be moved? */
-        if (GGGGC_GEN_OF(obj) <= gen) {
-            struct GGGGC_Header *nobj;
-            struct GGGGC_Descriptor *descriptor = obj->descriptor__ptr;
-
+        pool = GGGGC_POOL_OF(obj);
+        if (pool->gen <= gen
+#ifdef GGGGC_SURVIVOR_SPACES
+            && !pool->toSpace
+#endif
+            ) {
+            struct GGGGC_Header *nobj = NULL;
+            struct GGGGC_Descriptor *descriptor;
+            ggc_size_t descriptorI = (ggc_size_t) obj->descriptor__ptr;
+
+            /* claim it. If another worker has claimed it, wait for them to
+             * forward it */
+            if ((descriptorI & 1) ||
+                (descriptorI & 2) ||
+                !GGGGC_CAS((ggc_size_t *) (void *) &obj->descriptor__ptr,
+                           descriptorI, descriptorI | 2)) {
+                if (promotionFailed) continue;
+                if (descriptorI & 2) ggc_thread_yield();
+                goto retry;
+            }
+            descriptor = (struct GGGGC_Descriptor *) descriptorI;
             FOLLOW_FORWARDED_DESCRIPTOR(descriptor);
 
             /* mark it as surviving */
-            GGGGC_POOL_OF(obj)->survivors += descriptor->size;
-
+            GGGGC_ATOMIC_ADD(&pool->survivors, descriptor->size);
+
+#ifdef GGGGC_SURVIVOR_SPACES
+            /* allocate in the survivor spaces if it's young enough, or else in
+             * the new generation */
+            if (pool->gen == 0 && pool->age < tenuringThreshold)
+                nobj = promotionAlloc(w, descriptor->size, 0, pool->age + 1);
+            if (!nobj)
+                nobj = promotionAlloc(w, descriptor->size, gen + 1, 0);
+#else
             /* allocate in the new generation */
-            nobj = (struct GGGGC_Header *) ggggc_mallocGen1(descriptor->size, gen + 1);
+            nobj = promotionAlloc(w, descriptor->size, gen + 1, 0);
+#endif
             if (!nobj) {
-#ifdef GGGGC_FEATURE_FINALIZERS
-                /* preserve all finalizers */
-                if (survivingFinalizers) {
-                    poolCur = GGGGC_POOL_OF(survivingFinalizers);
-                    poolCur->finalizers = survivingFinalizers;
-                    survivingFinalizersTail->next__ptr = readyFinalizers;
-                } else if (readyFinalizers) {
-                    poolCur = GGGGC_POOL_OF(readyFinalizers);
-                    poolCur->finalizers = readyFinalizers;
+                /* failed to allocate, release it and give up */
+                obj->descriptor__ptr = (struct GGGGC_Descriptor *) descriptorI;
+                promotionFailed = 1;
+                continue;
+            }
+
+            /* copy to the new object */
+            memcpy(nobj, obj, descriptor->size * sizeof(ggc_size_t));
+            nobj->descriptor__ptr = (struct GGGGC_Descriptor *) descriptorI;
+
+            /* mark it as forwarded, only once the copy is visible */
+            GGGGC_MEMORY_BARRIER();
+            obj->descriptor__ptr = (struct GGGGC_Descriptor *) (((ggc_size_t) nobj) | 1);
+            *ptr = obj = nobj;
+
+            /* and add its pointers */
+            SCAN_OBJECT_POINTERS(obj, obj->descriptor__ptr, EVACUATE_ADD);
+        }
+
+#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
+        /* check for post-corruption */
+        if (obj->ggggc_memoryCorruptionCheck != GGGGC_MEMORY_CORRUPTION_VAL) {
+            fprintf(stderr, "GGGGC: Memory corruption (postcheck)!\n");
+            abort();
+        }
+#endif
+    }
+#undef EVACUATE_ADD
+
+    /* leave the generation walkable */
+    if (w->promotion.pool) evacuationBufferRetire(&w->promotion);
+#ifdef GGGGC_SURVIVOR_SPACES
+    {
+        unsigned char age;
+        for (age = 1; age <= GGGGC_TENURING_THRESHOLD; age++)
+            if (w->survivor[age].pool) evacuationBufferRetire(&w->survivor[age]);
+    }
+#endif
+}
+
+#ifdef GGGGC_SURVIVOR_SPACES
+/* put the survivor pools being evacuated into with the others, as after an
+ * evacuation fails, they're just as much to be evacuated */
+static void survivorMerge()
+{
+    struct GGGGC_Pool *poolCur, *next;
+
+    for (poolCur = survivorToPools; poolCur; poolCur = next) {
+        next = poolCur->next;
+        poolCur->toSpace = 0;
+        poolCur->next = survivorPools;
+        survivorPools = poolCur;
+    }
+    survivorToPools = NULL;
+    memset(survivorCur, 0, sizeof(survivorCur));
+}
+
+/* prepare the survivor spaces for an evacuation of generations up to gen */
+static void survivorBegin(unsigned char gen)
+{
+    struct GGGGC_Pool *poolCur;
+
+    survivorMerge();
+
+    /* remember where promotion starts, to find what it promoted */
+    for (poolCur = ggggc_gens[gen+1]; poolCur; poolCur = poolCur->next)
+        poolCur->promoteStart = poolCur->free;
+}
+
+/* does this object point into generation 0? */
+static int survivorPointsYoung(struct GGGGC_Header *obj)
+{
+    int young = 0;
+
+#define YOUNG_ADD(ptr) do { \
+    void *yptr = *(void **) (ptr); \
+    if (yptr && !IS_TAGGED(yptr) && GGGGC_GEN_OF(yptr) == 0) young = 1; \
+} while (0)
+    SCAN_OBJECT_POINTERS(obj, obj->descriptor__ptr, YOUNG_ADD);
+#undef YOUNG_ADD
+
+    return young;
+}
+
+/* after a successful evacuation of generations up to gen, free the evacuated
+ * survivor pools, remember the pointers into the new ones, and adjust the
+ * tenuring threshold */
+static void survivorEnd(unsigned char gen)
+{
+    struct GGGGC_PoolList *plCur;
+    struct GGGGC_Pool *poolCur;
+    struct GGGGC_Header *obj;
+    ggc_size_t ageWords[GGGGC_TENURING_THRESHOLD + 1];
+    ggc_size_t i, j, desired, total;
+    unsigned char age;
+
+    ggggc_freeGeneration(survivorPools);
+    survivorPools = NULL;
+    survivorMerge();
+
+    /* generation gen+1's remembered cards may still point into the survivor
+     * spaces, as may what was just promoted into it */
+    for (poolCur = ggggc_gens[gen+1]; poolCur; poolCur = poolCur->next) {
+        if (!survivorPools) {
+            clearRemembered(poolCur);
+            continue;
+        }
+
+        for (j = 0; j < GGGGC_SUMMARIES_PER_POOL; j++) {
+            if (!poolCur->rememberSummary[j]) continue;
+            poolCur->rememberSummary[j] = 0;
+            for (i = j * GGGGC_CARDS_PER_SUMMARY; i < j * GGGGC_CARDS_PER_SUMMARY + SUMMARY_CARDS; i++) {
+                if (!poolCur->remember[i]) continue;
+                poolCur->remember[i] = 0;
+                obj = (struct GGGGC_Header *)
+                    ((ggc_size_t) poolCur + i * GGGGC_CARD_BYTES + poolCur->firstObject[i] * sizeof(ggc_size_t));
+                while (GGGGC_CARD_OF(obj) == i && (ggc_size_t *) obj < poolCur->free) {
+                    if (survivorPointsYoung(obj)) {
+                        REMEMBER_CARD(poolCur, i);
+                        break;
+                    }
+                    obj = (struct GGGGC_Header *)
+                        ((ggc_size_t) obj + obj->descriptor__ptr->size * sizeof(ggc_size_t));
                 }
-                survivingFinalizers = survivingFinalizersTail =
-                    readyFinalizers = NULL;
+            }
+        }
+
+        for (obj = (struct GGGGC_Header *) poolCur->promoteStart;
+             (ggc_size_t *) obj < poolCur->free;
+             obj = (struct GGGGC_Header *)
+                ((ggc_size_t) obj + obj->descriptor__ptr->size * sizeof(ggc_size_t))) {
+            if (survivorPointsYoung(obj))
+                REMEMBER_CARD(poolCur, GGGGC_CARD_OF(obj));
+        }
+    }
+
+    /* promote the oldest survivors once they outgrow half the nursery */
+    memset(ageWords, 0, sizeof(ageWords));
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next)
+        ageWords[poolCur->age] += poolCur->free - poolCur->start;
+    desired = 0;
+    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next)
+        for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next)
+            desired += poolCur->end - poolCur->start;
+    desired /= 2;
+    total = 0;
+    for (age = 1; age < GGGGC_TENURING_THRESHOLD; age++) {
+        total += ageWords[age];
+        if (total > desired) break;
+    }
+    tenuringThreshold = age;
+}
 #endif
 
-                /* failed to allocate, need to collect gen+1 too */
-                gen += 1;
-                TOSEARCH_INIT();
-#ifdef GGGGC_DEBUG_REPORT_COLLECTIONS
-                report(gen, "promotion");
+/* after a nursery collection of generations up to gen, forget the remembered
+ * large objects of generation gen+1, as its pools' cards were forgotten */
+static void largeRefilter(unsigned char gen)
+{
+    struct GGGGC_Pool *poolCur;
+
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next) {
+        if (poolCur->gen != gen + 1) continue;
+#ifdef GGGGC_SURVIVOR_SPACES
+        /* unless they point into the survivor spaces */
+        if (survivorPools && poolCur->remember[GGGGC_CARD_OF(poolCur->start)] &&
+            survivorPointsYoung((struct GGGGC_Header *) poolCur->start))
+            continue;
+#endif
+        clearRemembered(poolCur);
+    }
+}
+#endif /* GGGGC_GENERATIONS > 1 */
+
+/* mark bits live in the pool's side bitmap, one per word, so that marking reads
+ * objects but never writes them */
+#define MARK_WORD(obj) \
+    (((ggc_size_t) (obj) & GGGGC_POOL_INNER_MASK) / sizeof(ggc_size_t))
+#define MARK_BITS(obj) \
+    (GGGGC_POOL_OF(obj)->markBits[MARK_WORD(obj) / GGGGC_BITS_PER_WORD])
+#define MARK_BIT(obj) \
+    ((ggc_size_t) 1 << (MARK_WORD(obj) % GGGGC_BITS_PER_WORD))
+
+/* is this object marked? */
+#define IS_MARKED(obj) ((MARK_BITS(obj) & MARK_BIT(obj)) != 0)
+
+/* mark an object (only when no other thread is marking) */
+#define MARK(obj) (MARK_BITS(obj) |= MARK_BIT(obj))
+
+/* mark an object, unless another worker beats us to it. Returns 1 if we marked
+ * it. */
+static int markAtomic(struct GGGGC_Header *obj)
+{
+    volatile ggc_size_t *bits = &MARK_BITS(obj);
+    ggc_size_t bit = MARK_BIT(obj), old;
+
+    do {
+        old = *bits;
+        if (old & bit) return 0;
+    } while (!GGGGC_CAS(bits, old, old | bit));
+
+    return 1;
+}
+
+/* prefetch, where the compiler lets us */
+#if defined(__GNUC__) && !defined(GGGGC_NO_GNUC_BUILTINS)
+#define PREFETCH(x) __builtin_prefetch(x)
+#else
+#define PREFETCH(x) ((void) (x))
+#endif
+
+/* count bits, and find the lowest set bit (of a nonzero word) */
+#if defined(__GNUC__) && !defined(GGGGC_NO_GNUC_BUILTINS)
+#define POPCOUNT(x) ((ggc_size_t) __builtin_popcountll(x))
+#define CTZ(x) ((ggc_size_t) __builtin_ctzll(x))
+
+#else
+#ifndef GGGGC_BREAK_TABLE_COMPACTION
+static ggc_size_t popcount(ggc_size_t x)
+{
+    ggc_size_t ret = 0;
+    for (; x; x &= x - 1) ret++;
+    return ret;
+}
+#endif
+
+static ggc_size_t ctz(ggc_size_t x)
+{
+    ggc_size_t ret = 0;
+    for (; !(x & 1); x >>= 1) ret++;
+    return ret;
+}
+
+#define POPCOUNT(x) popcount(x)
+#define CTZ(x) ctz(x)
+
+#endif
+
+/* find the first word in [word, limit) whose mark bit is set (or clear, if
+ * !set), or limit if there is none */
+static ggc_size_t nextMarkBit(ggc_size_t *bits, ggc_size_t word, ggc_size_t limit, int set)
+{
+    ggc_size_t block = word / GGGGC_BITS_PER_WORD;
+    ggc_size_t cur = set ? bits[block] : ~bits[block];
+
+    cur &= (ggc_size_t) -1 << (word % GGGGC_BITS_PER_WORD);
+    while (!cur) {
+        if (++block * GGGGC_BITS_PER_WORD >= limit) return limit;
+        cur = set ? bits[block] : ~bits[block];
+    }
+
+    word = block * GGGGC_BITS_PER_WORD + CTZ(cur);
+    return (word < limit) ? word : limit;
+}
+
+/* clear the mark bits of [pool->start, to) */
+static void clearMarks(struct GGGGC_Pool *pool, ggc_size_t *to)
+{
+    memset(pool->markBits, 0,
+        (to - (ggc_size_t *) pool + GGGGC_BITS_PER_WORD - 1) / GGGGC_BITS_PER_WORD *
+        sizeof(ggc_size_t));
+}
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+/* Concurrent or incremental marking of the old generation. When a minor
+ * collection leaves the old generation filling up, we mark from the roots, and
+ * then mark what they reach on a marker thread while the mutators run, or in
+ * slices during later minor collections. While marking, the write barrier logs
+ * every pointer overwritten in the old generation, so everything reachable
+ * when marking started gets marked (snapshot at the beginning), and everything
+ * promoted since is above its pool's markTop and considered live. The next
+ * full collection then only has to finish marking in its pause. */
+#define CONCURRENT_IDLE     0
+#define CONCURRENT_MARKING  1
+#define CONCURRENT_MARKED   2
+static volatile int concurrentState;
+
+/* set while the write barrier must log */
+volatile int ggggc_concurrentMarking;
+
+/* start marking when the old generation is this full (as a right shift of its
+ * size, so 1 is half full) */
+#define CONCURRENT_TRIGGER 1
+
+/* the marker yields after scanning this many objects */
+#define CONCURRENT_STEP 256
+
+/* grey objects: marked, but not yet scanned */
+static struct GGGGC_Header **concurrentGrey;
+static ggc_size_t concurrentGreyUsed, concurrentGreySize;
+
+/* logs of overwritten pointers, thread-local until full */
+static ggc_thread_local struct LogBuffer *satbBuffer;
+static struct LogBuffer *satbFull;
+static ggc_mutex_t satbLock = GGC_MUTEX_INITIALIZER;
+
+#ifdef GGGGC_CONCURRENT_MARKING
+/* the marker thread, which waits on concurrentMarkerWake between cycles */
+static ggc_thread_t concurrentMarkerThread;
+static ggc_sem_t concurrentMarkerWake;
+static int concurrentMarkerStarted;
 #endif
-                goto collect;
+
+/* hand this thread's log to the marker */
+void ggggc_satbFlush()
+{
+    logFlush(&satbBuffer, &satbFull, &satbLock);
+}
+
+/* log an overwritten pointer */
+void ggggc_satbLog(void *ptr)
+{
+    logAdd(&satbBuffer, &satbFull, &satbLock, ptr);
+}
+
+/* mark an object for the concurrent marker, if it was there when we started */
+static void concurrentMark(void *ptr)
+{
+    struct GGGGC_Header *obj = (struct GGGGC_Header *) ptr;
+    struct GGGGC_Pool *pool;
+
+    if (obj == NULL || IS_TAGGED(obj)) return;
+    pool = GGGGC_POOL_OF(obj);
+    if (pool->gen == 0 || (ggc_size_t *) obj >= pool->markTop) return;
+    if (IS_MARKED(obj)) return;
+    MARK(obj);
+
+    if (concurrentGreyUsed == concurrentGreySize) {
+        concurrentGreySize = concurrentGreySize ? concurrentGreySize * 2 : 1024;
+        concurrentGrey = (struct GGGGC_Header **)
+            realloc(concurrentGrey, concurrentGreySize * sizeof(struct GGGGC_Header *));
+        if (concurrentGrey == NULL) {
+            perror("realloc");
+            abort();
+        }
+    }
+    concurrentGrey[concurrentGreyUsed++] = obj;
+}
+
+/* mark everything logged so far. Returns 0 if there was nothing to log. */
+static int concurrentDrainLogs()
+{
+    struct LogBuffer *buf, *next;
+    ggc_size_t i;
+
+    ggc_mutex_lock_raw(&satbLock);
+    buf = satbFull;
+    satbFull = NULL;
+    ggc_mutex_unlock(&satbLock);
+    if (!buf) return 0;
+
+    for (; buf; buf = next) {
+        next = buf->next;
+        for (i = 0; i < buf->used; i++)
+            concurrentMark(buf->buf[i]);
+        free(buf);
+    }
+    return 1;
+}
+
+/* scan a few grey objects. Returns 0 when there's nothing left to do. */
+static int concurrentStep()
+{
+    struct GGGGC_Header *obj;
+    struct GGGGC_Descriptor *descriptor;
+    ggc_size_t i;
+
+#define CONCURRENT_ADD(ptr) concurrentMark(*(void * volatile *) (ptr))
+    for (i = 0; i < CONCURRENT_STEP; i++) {
+        while (concurrentGreyUsed == 0)
+            if (!concurrentDrainLogs()) return 0;
+
+        obj = concurrentGrey[--concurrentGreyUsed];
+        descriptor = obj->descriptor__ptr;
+        SCAN_OBJECT_POINTERS(obj, descriptor, CONCURRENT_ADD);
+    }
+#undef CONCURRENT_ADD
+
+    return 1;
+}
+
+#ifdef GGGGC_CONCURRENT_MARKING
+/* the marker thread */
+static void concurrentMarker(GGC_ThreadArg arg)
+{
+    while (1) {
+        while (concurrentState == CONCURRENT_MARKING) {
+            if (!concurrentStep()) {
+                concurrentState = CONCURRENT_MARKED;
+                break;
             }
+            GGC_YIELD();
+        }
 
-            /* copy to the new object */
-            memcpy(nobj, obj, descriptor->size * sizeof(ggc_size_t));
+        /* wait for another cycle */
+        ggc_sem_wait(&concurrentMarkerWake);
+    }
+}
+#endif
+
+#ifdef GGGGC_INCREMENTAL_MARKING
+/* mark for up to GGGGC_INCREMENTAL_BUDGET microseconds, while the world is
+ * stopped anyway */
+static void incrementalSlice()
+{
+    clock_t end = clock() +
+        (clock_t) ((double) GGGGC_INCREMENTAL_BUDGET * CLOCKS_PER_SEC / 1000000);
+
+    while (concurrentState == CONCURRENT_MARKING) {
+        if (!concurrentStep()) {
+            concurrentState = CONCURRENT_MARKED;
+            break;
+        }
+        if (clock() >= end) break;
+    }
+}
+#endif
+
+/* at the end of a minor collection, start marking if the old generation is
+ * filling up. Returns 0 if not, 1 if the marker needs to be woken, or 2 if it
+ * needs to be created (there is only a marker with GGGGC_CONCURRENT_MARKING). */
+static int concurrentStart()
+{
+    struct GGGGC_Pool *poolCur;
+    struct GGGGC_PointerStackList *pslCur;
+    struct GGGGC_PointerStack *psCur;
+    ggc_size_t i, used = 0, size = 0;
+#ifdef GGGGC_FEATURE_JITPSTACK
+    struct GGGGC_JITPointerStackList *jpslCur;
+    void **jpsCur;
+#endif
+
+    if (concurrentState != CONCURRENT_IDLE) return 0;
+    for (poolCur = ggggc_gens[1]; poolCur; poolCur = poolCur->next) {
+        used += poolCur->free - poolCur->start;
+        size += poolCur->end - poolCur->start;
+    }
+    if (used < (size >> CONCURRENT_TRIGGER)) return 0;
+
+    /* everything currently in the old generation is in the snapshot (the mark
+     * bits are already clear) */
+    for (poolCur = ggggc_gens[1]; poolCur; poolCur = poolCur->next)
+        poolCur->markTop = poolCur->free;
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+        poolCur->markTop = poolCur->free;
+
+    /* mark our roots */
+    concurrentGreyUsed = 0;
+    for (pslCur = ggggc_rootPointerStackList; pslCur; pslCur = pslCur->next) {
+        for (psCur = pslCur->pointerStack; psCur; psCur = psCur->next) {
+            for (i = 0; i < psCur->size; i++) {
+                if (psCur->pointers[i])
+                    concurrentMark(*(void **) psCur->pointers[i]);
+            }
+        }
+    }
+
+#ifdef GGGGC_FEATURE_JITPSTACK
+    for (jpslCur = ggggc_rootJITPointerStackList; jpslCur; jpslCur = jpslCur->next) {
+        for (jpsCur = jpslCur->cur; jpsCur < jpslCur->top; jpsCur++) {
+#ifndef GGGGC_FEATURE_EXTTAG
+            concurrentMark(*jpsCur);
+#else
+            int wordIdx;
+            size_t tags = *((ggc_size_t *) jpsCur);
+            for (wordIdx = 0; wordIdx < sizeof(ggc_size_t); wordIdx++) {
+                unsigned char tag = tags & 0xFF;
+                tags >>= 8;
+                if (tag == 0xFF) {
+                    /* End-of-tags tag */
+                    break;
+                }
+                jpsCur++;
+                /* Lowest bit indicates pointer */
+                if ((tag & 0x1) == 0)
+                    concurrentMark(*jpsCur);
+            }
+#endif /* GGGGC_FEATURE_EXTTAG */
+        }
+    }
+#endif /* GGGGC_FEATURE_JITPSTACK */
+
+#ifdef GGGGC_SURVIVOR_SPACES
+    /* the write barrier doesn't see stores into survivors, so whatever they
+     * point to is in the snapshot too */
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+        ggc_size_t *cur;
+        struct GGGGC_Header *obj;
+#define CONCURRENT_ADD(ptr) concurrentMark(*(void **) (ptr))
+        for (cur = poolCur->start; cur < poolCur->free; cur += obj->descriptor__ptr->size) {
+            obj = (struct GGGGC_Header *) cur;
+            SCAN_OBJECT_POINTERS(obj, obj->descriptor__ptr, CONCURRENT_ADD);
+        }
+#undef CONCURRENT_ADD
+    }
+#endif
+
+    /* and let the marker take it from here */
+    concurrentState = CONCURRENT_MARKING;
+    ggggc_concurrentMarking = 1;
+#ifdef GGGGC_CONCURRENT_MARKING
+    if (!concurrentMarkerStarted) {
+        concurrentMarkerStarted = 1;
+        ggc_sem_init(&concurrentMarkerWake, 0);
+        return 2;
+    }
+#endif
+    return 1;
+}
+
+/* forget any concurrent marking, at the end of a full collection */
+static void concurrentEnd()
+{
+    struct LogBuffer *buf, *next;
+
+    concurrentState = CONCURRENT_IDLE;
+    ggggc_concurrentMarking = 0;
+    concurrentGreyUsed = 0;
+    for (buf = satbFull; buf; buf = next) {
+        next = buf->next;
+        free(buf);
+    }
+    satbFull = NULL;
+}
+#endif /* GGGGC_SNAPSHOT_MARKING */
+
+/* in the child of a fork, forget what other threads were doing */
+void ggggc_collectorForkChild()
+{
+#if defined(GGGGC_SNAPSHOT_MARKING) || defined(GGGGC_SLOT_LOGGING)
+    static ggc_mutex_t lockInit = GGC_MUTEX_INITIALIZER;
+    struct GGGGC_Pool *poolCur;
+#endif
+#ifdef GGGGC_SLOT_LOGGING
+    unsigned char genCur;
+    ggc_size_t *cur;
+
+    /* other threads' logged slots are gone but still marked as logged, so
+     * forget all the marks and remember the card of every object instead */
+    slotLogLock = lockInit;
+    for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
+        for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
+            memset(poolCur->loggedBits, 0, sizeof(poolCur->loggedBits));
+            for (cur = poolCur->start; cur < poolCur->free;
+                 cur += ((struct GGGGC_Header *) cur)->descriptor__ptr->size)
+                REMEMBER_CARD(poolCur, GGGGC_CARD_OF(cur));
+        }
+    }
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+        REMEMBER_CARD(poolCur, GGGGC_CARD_OF(poolCur->start));
+#endif
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+    satbLock = lockInit;
+#ifdef GGGGC_CONCURRENT_MARKING
+    concurrentMarkerStarted = 0;
+#endif
+
+    /* other threads' logs are gone, so marking can't be finished */
+    if (concurrentState != CONCURRENT_IDLE) {
+        for (poolCur = ggggc_gens[1]; poolCur; poolCur = poolCur->next)
+            clearMarks(poolCur, poolCur->markTop);
+        for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+            clearMarks(poolCur, poolCur->start + 1);
+        if (satbBuffer) satbBuffer->used = 0;
+        concurrentEnd();
+    }
+#endif
+}
+
+/* examine the probes of allocation sites after a nursery collection, and
+ * pretenure the sites whose objects survived. Probes are only hints (a probe
+ * into the pool of an exited thread may be stale), so they're only believed
+ * if they still point into a nursery. */
+static void allocSitesFeedback(void)
+{
+    struct GGGGC_AllocSite *site;
+    struct GGGGC_Header *probe;
+    ggc_size_t i, probes;
+
+    for (site = allocSites; site; site = site->next) {
+        probes = site->allocated;
+        if (probes > GGGGC_SITE_PROBES) probes = GGGGC_SITE_PROBES;
+        for (i = 0; i < probes; i++) {
+            probe = (struct GGGGC_Header *) site->probes[i];
+#if GGGGC_GENERATIONS > 1
+            if (GGGGC_POOL_OF(probe)->gen != 0) continue;
+#endif
+            site->sampled++;
+            if (IS_FORWARDED_OBJECT(probe))
+                site->survived++;
+        }
+        site->allocated = 0;
+
+        if (site->sampled >= GGGGC_PRETENURE_SAMPLES) {
+            if (site->survived * 100 >= site->sampled * GGGGC_PRETENURE_PERCENT)
+                site->old = 1;
+            site->sampled = site->survived = 0;
+        }
+    }
+}
+
+/* after a full collection, probes can't be examined, and pretenured sites get
+ * another chance to show that their objects die young */
+static void allocSitesReset(void)
+{
+    struct GGGGC_AllocSite *site;
+    for (site = allocSites; site; site = site->next) {
+        site->allocated = 0;
+        site->old = 0;
+    }
+}
+
+/* Heap sizing. After each collection, the pool lists it collected are resized
+ * from how long it took and how much survived it:
+ *  - Each thread's nursery doubles when more than half of it survives. Besides
+ *    that, the nurseries shrink while minor collections take longer than
+ *    GGGGC_PAUSE_TARGET, and grow while collecting takes more than
+ *    GGGGC_GC_OVERHEAD percent of the time, but only so long as growing
+ *    actually brings that down.
+ *  - Older generations (and, without generations, the whole heap) double when
+ *    more than half of them survives, and more while the overhead is too
+ *    high. They shrink to twice what survived when that's less than half
+ *    what they have.
+ * Growth stops at GGGGC_HEAP_MAX_POOLS, and shrinking at GGGGC_HEAP_MIN_POOLS.
+ * Only empty pools can be freed. */
+
+#if GGGGC_GENERATIONS > 1
+/* how to resize the nurseries after a minor collection */
+#define NURSERY_KEEP    0
+#define NURSERY_GROW    1 /* for the overhead */
+#define NURSERY_SHRINK  2 /* for the pause time */
+#define NURSERY_UNDO    3 /* growing for the overhead didn't help */
+
+/* the nursery size at which growing it stopped lowering the overhead, or 0 */
+static ggc_size_t nurseryLimit;
+
+/* if the nurseries were just grown for the overhead, the overhead before */
+static ggc_size_t nurseryProbe;
+
+/* a running average of how long minor collections take */
+static clock_t policyPause;
+
+#define PAUSE_TARGET_CLOCKS \
+    ((clock_t) ((double) GGGGC_PAUSE_TARGET * CLOCKS_PER_SEC / 1000000))
+#endif
+
+/* the number of pools in the heap, during resizing */
+static ggc_size_t heapPools;
+
+/* when the last collection ended, and a running average of what percent of
+ * the time goes to collecting */
+static clock_t policyLastEnd;
+static ggc_size_t policyOverhead;
+
+/* collections are only timed if there's a target to time them against, since
+ * clock() isn't free */
+#if GGGGC_PAUSE_TARGET || GGGGC_GC_OVERHEAD
+#define POLICY_CLOCK() clock()
+#else
+#define POLICY_CLOCK() ((clock_t) 0)
+#endif
+
+/* count the pools in the heap */
+static ggc_size_t policyCountHeap(void)
+{
+    struct GGGGC_PoolList *plCur;
+    struct GGGGC_Pool *poolCur;
+    unsigned char genCur;
+    ggc_size_t count = 0;
+
+    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next)
+        for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next)
+            count++;
+    for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++)
+        for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next)
+            count++;
+#ifdef GGGGC_SURVIVOR_SPACES
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next)
+        count++;
+#endif
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+        count += ((unsigned char *) poolCur->end - (unsigned char *) poolCur) / GGGGC_POOL_BYTES;
+
+    return count;
+}
+
+/* count the pools in a list, adding up their space and survivors (and
+ * resetting the latter if reset is set) */
+static ggc_size_t policyMeasure(struct GGGGC_Pool *pool, ggc_size_t *space,
+                                ggc_size_t *survivors, int reset)
+{
+    ggc_size_t count = 0;
+    for (; pool; pool = pool->next) {
+        *space += pool->end - pool->start;
+        *survivors += pool->survivors;
+        if (reset) pool->survivors = 0;
+        count++;
+    }
+    return count;
+}
+
+/* the number of pools an older generation of count pools should have for its
+ * survivors */
+static ggc_size_t policyOldPools(struct GGGGC_Pool *list, ggc_size_t count,
+                                 ggc_size_t space, ggc_size_t survivors)
+{
+    ggc_size_t poolWords = list->end - list->start;
+    ggc_size_t desired = count;
+    if (survivors * 2 > space) {
+        /* too full, so double it */
+        desired = count * 2;
+        if (GGGGC_GC_OVERHEAD && policyOverhead > GGGGC_GC_OVERHEAD)
+            desired += count;
+    } else if (survivors * 4 < space) {
+        /* mostly empty, so bring it down to twice its survivors */
+        desired = (survivors * 2 + poolWords - 1) / poolWords;
+    }
+    return desired ? desired : 1;
+}
+
+/* grow or shrink a pool list of count pools toward desired pools, within the
+ * heap's bounds. It grows at its end, and shrinks by freeing empty pools other
+ * than its first (only if shrink is set) */
+static void policyResizeList(struct GGGGC_Pool *list, ggc_size_t count,
+                             ggc_size_t desired, int shrink)
+{
+    struct GGGGC_Pool *pool, **prev, *freed = NULL;
+
+    if (desired > count) {
+        if (GGGGC_HEAP_MAX_POOLS && heapPools + desired - count > GGGGC_HEAP_MAX_POOLS)
+            desired = (heapPools < GGGGC_HEAP_MAX_POOLS) ?
+                count + GGGGC_HEAP_MAX_POOLS - heapPools : count;
+        for (pool = list; pool->next; pool = pool->next);
+        for (; count < desired; count++) {
+            pool->next = newPoolGenProto(list);
+            if (!pool->next) break;
+            pool = pool->next;
+            heapPools++;
+        }
+
+    } else if (desired < count && shrink) {
+        if (heapPools - (count - desired) < GGGGC_HEAP_MIN_POOLS)
+            desired = (heapPools > GGGGC_HEAP_MIN_POOLS) ?
+                count - (heapPools - GGGGC_HEAP_MIN_POOLS) : count;
+        prev = &list->next;
+        while ((pool = *prev) && count > desired) {
+            if (pool->free == pool->start) {
+                *prev = pool->next;
+                pool->next = freed;
+                freed = pool;
+                count--;
+                heapPools--;
+            } else {
+                prev = &pool->next;
+            }
+        }
+        ggggc_freeGeneration(freed);
+
+    }
+}
+
+/* resize what a collection of generations up to gen collected, given how long
+ * it took */
+static void policyResize(unsigned char gen, clock_t pause)
+{
+    struct GGGGC_PoolList *plCur, *blCur;
+    struct GGGGC_Pool *poolCur;
+    unsigned char genCur;
+    ggc_size_t space, survivors, count, desired, overhead;
+#if GGGGC_GENERATIONS > 1
+    int action = NURSERY_KEEP;
+#endif
+    clock_t now = POLICY_CLOCK();
+    int shrink;
+
+    /* how much of the time since the last collection went to this one */
+    overhead = (now > policyLastEnd) ?
+        (ggc_size_t) (pause * 100 / (now - policyLastEnd)) : 100;
+    policyOverhead = (policyOverhead * 3 + overhead) / 4;
+    policyLastEnd = now;
+    heapPools = policyCountHeap();
+
+#if GGGGC_GENERATIONS > 1
+    if (gen < GGGGC_GENERATIONS - 1) {
+        /* decide what this minor collection says about the nurseries */
+        policyPause = (policyPause * 3 + pause) / 4;
+        if (nurseryProbe) {
+            if (overhead * 4 > nurseryProbe * 3) {
+                action = NURSERY_UNDO;
+                nurseryLimit = 1;
+            }
+            nurseryProbe = 0;
+
+        } else if (GGGGC_PAUSE_TARGET && policyPause > PAUSE_TARGET_CLOCKS) {
+            action = NURSERY_SHRINK;
+
+        } else if (GGGGC_GC_OVERHEAD && policyOverhead > GGGGC_GC_OVERHEAD) {
+            action = NURSERY_GROW;
+
+        }
+
+    } else {
+        /* the program may have changed, so growing may help again */
+        nurseryLimit = 0;
+
+    }
+#endif
+
+    /* resize the nurseries, but threads that are blocked may be allocating in
+     * any of their pools, so can't lose any */
+    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
+        if (!plCur->pool) continue;
+        shrink = 1;
+        for (blCur = ggggc_blockedThreadPool0s; blCur; blCur = blCur->next)
+            if (blCur == plCur) shrink = 0;
+        space = survivors = 0;
+        count = policyMeasure(plCur->pool, &space, &survivors, 1);
+#if GGGGC_GENERATIONS > 1
+        desired = count;
+        if (action == NURSERY_SHRINK) {
+            desired = count * 3 / 4;
+        } else if (action == NURSERY_UNDO) {
+            desired = count / 2;
+            if (desired > nurseryLimit) nurseryLimit = desired;
+        } else if (survivors * 2 > space) {
+            desired = count * 2;
+        } else if (action == NURSERY_GROW &&
+                   (!nurseryLimit || count < nurseryLimit)) {
+            desired = count * 2;
+            if (nurseryLimit && desired > nurseryLimit) desired = nurseryLimit;
+            nurseryProbe = overhead ? overhead : 1;
+        }
+        if (!desired) desired = 1;
+#else
+        desired = policyOldPools(plCur->pool, count, space, survivors);
+#endif
+        policyResizeList(plCur->pool, count, desired, shrink);
+    }
+
+    /* and the older generations that were collected */
+    for (genCur = 1; genCur <= gen; genCur++) {
+        poolCur = ggggc_gens[genCur];
+        if (!poolCur) continue;
+        space = survivors = 0;
+        count = policyMeasure(poolCur, &space, &survivors, 1);
+        desired = policyOldPools(poolCur, count, space, survivors);
+        policyResizeList(poolCur, count, desired, 1);
+    }
+}
+
+/* run a generation 0 collection */
+void ggggc_collect0(unsigned char gen)
+{
+    struct GGGGC_PoolList pool0Node, *plCur;
+    struct GGGGC_Pool *poolCur;
+    struct GGGGC_PointerStackList pointerStackNode;
+    unsigned char genCur;
+#ifdef GGGGC_FEATURE_JITPSTACK
+    struct GGGGC_JITPointerStackList jitPointerStackNode;
+#endif
+    clock_t pauseStart;
+#ifdef GGGGC_CONCURRENT_MARKING
+    int startMarker = 0;
+#endif
+#ifdef GGGGC_FEATURE_FINALIZERS
+    GGGGC_FinalizerEntry survivingFinalizers, survivingFinalizersTail, readyFinalizers;
+    survivingFinalizers = survivingFinalizersTail = readyFinalizers = NULL;
+#endif
+#ifdef GGGGC_SNAPSHOT_MARKING
+    /* our logged pointers need to be visible to the collection */
+    ggggc_satbFlush();
+#endif
+#ifdef GGGGC_SLOT_LOGGING
+    ggggc_slotLogFlush();
+#endif
+
+    /* first, make sure we stop the world */
+    while (ggc_mutex_trylock(&ggggc_worldBarrierLock) != 0) {
+        /* somebody else is collecting */
+        GGC_YIELD();
+    }
+
+    /* if nobody ever initialized the barrier, do so */
+    if (ggggc_threadCount == (ggc_size_t) -1) {
+        ggggc_threadCount = 1;
+        ggc_barrier_init(&ggggc_worldBarrier, ggggc_threadCount);
+    }
+
+    /* initialize our roots */
+    ggc_mutex_lock_raw(&ggggc_rootsLock);
+    pool0Node.pool = ggggc_gen0;
+    pool0Node.next = ggggc_blockedThreadPool0s;
+    ggggc_rootPool0List = &pool0Node;
+    pointerStackNode.pointerStack = ggggc_pointerStack;
+    pointerStackNode.next = ggggc_blockedThreadPointerStacks;
+    ggggc_rootPointerStackList = &pointerStackNode;
+
+#ifdef GGGGC_FEATURE_JITPSTACK
+    jitPointerStackNode.cur = ggc_jitPointerStack;
+    jitPointerStackNode.top = ggc_jitPointerStackEnd;
+    jitPointerStackNode.next = ggggc_blockedThreadJITPointerStacks;
+    ggggc_rootJITPointerStackList = &jitPointerStackNode;
+#endif
+
+    /* we're the first collection worker, others will join */
+    workerCount = 1;
+
+    ggc_mutex_unlock(&ggggc_rootsLock);
+
+    /* stop the world */
+    pauseStart = POLICY_CLOCK();
+    ggggc_stopTheWorld = 1;
+    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+    ggggc_stopTheWorld = 0;
+
+    /* wait for them to fill roots */
+    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+
+#ifdef GGGGC_DEBUG_REPORT_COLLECTIONS
+    report(gen, "pre-collection");
+#endif
+
+#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
+    memoryCorruptionCheck("pre-collection");
+#endif
+
+    /************************************************************
+     * COLLECTION
+     ***********************************************************/
+collect:
+
+    /* possibly jump to a full collection */
+    if (
+#if GGGGC_GENERATIONS > 1
+        gen >= GGGGC_GENERATIONS - 1
+#else
+        1
+#endif
+    ) {
+        ggggc_collectFull(
+#ifdef GGGGC_FEATURE_FINALIZERS
+            &survivingFinalizers, &survivingFinalizersTail, &readyFinalizers
+#endif
+        );
+        goto postCollect;
+    }
+
+#if GGGGC_GENERATIONS > 1
+#ifdef GGGGC_SURVIVOR_SPACES
+    survivorBegin(gen);
+#endif
+
+    /* find our roots and remembered pointers, in parallel */
+    evacuateGen = gen;
+    promotionFailed = 0;
+    workersInit();
+    runParallel(evacuateRootsPhase);
+
+    /* then evacuate everything they reach */
+    workActive = workerCount;
+    runParallel(evacuatePhase);
+
+#ifdef GGGGC_FEATURE_FINALIZERS
+    if (!promotionFailed) {
+        GGGGC_FinalizerEntry finalizer = NULL, nextFinalizer = NULL;
+        struct GGGGC_Header *obj;
+
+        /* add all the finalizers themselves */
+        for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
+            for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
+                FINALIZER_POOL();
+            }
+        }
+        for (genCur = 1; genCur <= gen; genCur++) {
+            for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
+                FINALIZER_POOL();
+            }
+        }
+#ifdef GGGGC_SURVIVOR_SPACES
+        for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+            FINALIZER_POOL();
+        }
+#endif
+
+        /* then make sure the finalizer queues get promoted */
+        WORK_PUSH(workers[0], &survivingFinalizers);
+        WORK_PUSH(workers[0], &survivingFinalizersTail);
+        WORK_PUSH(workers[0], &readyFinalizers);
+        workActive = workerCount;
+        runParallel(evacuatePhase);
+    }
+#endif /* GGGGC_FEATURE_FINALIZERS */
+
+    if (promotionFailed) {
+#ifdef GGGGC_FEATURE_FINALIZERS
+        /* preserve all finalizers */
+        if (survivingFinalizers) {
+            poolCur = GGGGC_POOL_OF(survivingFinalizers);
+            poolCur->finalizers = survivingFinalizers;
+            survivingFinalizersTail->next__ptr = readyFinalizers;
+        } else if (readyFinalizers) {
+            poolCur = GGGGC_POOL_OF(readyFinalizers);
+            poolCur->finalizers = readyFinalizers;
+        }
+        survivingFinalizers = survivingFinalizersTail =
+            readyFinalizers = NULL;
+#endif
+
+        /* failed to allocate, need to collect gen+1 too */
+        gen += 1;
+#ifdef GGGGC_DEBUG_REPORT_COLLECTIONS
+        report(gen, "promotion");
+#endif
+        goto collect;
+    }
+#endif /* GGGGC_GENERATIONS > 1 */
+
+postCollect:
+
+#ifdef GGGGC_FEATURE_FINALIZERS
+    /* preserve surviving finalizers */
+    if (survivingFinalizers) {
+        poolCur = GGGGC_POOL_OF(survivingFinalizers);
+        poolCur->finalizers = survivingFinalizers;
+    }
+#endif
+
+    /* clear out the now-empty generations, unless we did a full collection */
+    if (gen < GGGGC_GENERATIONS - 1) {
+        allocSitesFeedback();
+
+        for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
+            for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
+                poolCur->free = poolCur->start;
+            }
+        }
+        ggggc_pool0 = ggggc_gen0;
+#if GGGGC_GENERATIONS > 1
+        for (genCur = 1; genCur <= gen; genCur++) {
+            for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
+                clearRemembered(poolCur);
+                poolCur->free = poolCur->start;
+            }
+            ggggc_pools[genCur] = ggggc_gens[genCur];
+        }
+
+        /* and the remembered sets */
+#ifdef GGGGC_SURVIVOR_SPACES
+        survivorEnd(gen);
+#else
+        for (poolCur = ggggc_gens[gen+1]; poolCur; poolCur = poolCur->next) {
+            clearRemembered(poolCur);
+        }
+#endif
+        largeRefilter(gen);
+#ifdef GGGGC_SLOT_LOGGING
+        slotLogFilter(gen);
+#endif
+#endif
+
+#ifdef GGGGC_CONCURRENT_MARKING
+        /* perhaps start marking the old generation */
+        startMarker = concurrentStart();
+#elif defined(GGGGC_SNAPSHOT_MARKING)
+        concurrentStart();
+#endif
+#ifdef GGGGC_INCREMENTAL_MARKING
+        incrementalSlice();
+#endif
+    }
+
+    /* resize what we collected */
+    policyResize(gen, POLICY_CLOCK() - pauseStart);
+
+    /* and give back any pools that have been free for a while */
+    ggggc_releaseIdlePools();
+
+#ifdef GGGGC_DEBUG_REPORT_COLLECTIONS
+    report(gen, "post-collection");
+#endif
+
+#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
+    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
+        for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
+            memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
+        }
+    }
+    for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
+        for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
+            memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
+        }
+    }
+#ifdef GGGGC_SURVIVOR_SPACES
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+        memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
+    }
+#endif
+    memoryCorruptionCheck("post-collection");
+#endif
+
+    /* free the other threads */
+    workerPhase = NULL;
+    ggc_barrier_wait_raw(&ggggc_worldBarrier);
+    ggc_mutex_unlock(&ggggc_worldBarrierLock);
+
+#ifdef GGGGC_FEATURE_FINALIZERS
+    /* run our finalizers */
+    if (readyFinalizers)
+        ggggc_runFinalizers(readyFinalizers);
+#endif
+
+#ifdef GGGGC_CONCURRENT_MARKING
+    /* and get the marker going */
+    if (startMarker == 2)
+        ggc_thread_create(&concurrentMarkerThread, concurrentMarker, NULL);
+    else if (startMarker)
+        ggc_sem_post(&concurrentMarkerWake);
+#endif
+}
+
+#ifdef GGGGC_BREAK_TABLE_COMPACTION
+/* type for an element of our break table */
+struct BreakTableEl {
+    ggc_size_t *orig, *newL;
+};
+
+/* find the new location of an object that's been compacted */
+#define FOLLOW_COMPACTED_OBJECT(obj) do { \
+    ggc_size_t *dobj = (ggc_size_t *) (obj); \
+    struct BreakTableEl *bel = findBreakTableEntry(dobj); \
+    if (bel) { \
+        dobj -= bel->orig - bel->newL; \
+        obj = dobj; \
+    } \
+} while(0)
+
+/* start fetching what FOLLOW_COMPACTED_OBJECT will need for an object */
+#define PREFETCH_COMPACTED_OBJECT(obj) do { \
+    struct GGGGC_Pool *ppool = GGGGC_POOL_OF(obj); \
+    if (ppool->breakTableSize) \
+        PREFETCH((struct BreakTableEl *) ppool->breakTable + \
+                 ppool->breakTableIndex[GGGGC_CARD_OF(obj)]); \
+} while(0)
+
+/* the same, as an ADD for SCAN_OBJECT_POINTERS */
+#define COMPACT_PREFETCH(ptr) do { \
+    void *pptr = *(void **) (ptr); \
+    if (pptr) PREFETCH_COMPACTED_OBJECT(pptr); \
+} while (0)
+
+/* special case for compacted descriptors */
+#define FOLLOW_COMPACTED_DESCRIPTOR(d) do { \
+    ggc_size_t *dcobj = (ggc_size_t *) (d); \
+    FOLLOW_COMPACTED_OBJECT(dcobj); \
+    d = (struct GGGGC_Descriptor *) dcobj; \
+} while(0)
+
+/* comparator for break table elements */
+static int breakTableComparator(const void *lv, const void *rv)
+{
+    struct BreakTableEl *l, *r;
+    l = (struct BreakTableEl *) lv;
+    r = (struct BreakTableEl *) rv;
+    if (l->orig < r->orig) {
+        return -1;
+    } else if (l->orig > r->orig) {
+        return 1;
+    }
+    return 0;
+}
+
+/* index a pool's sorted break table by card, so that finding an entry only
+ * needs to search the entries within one card */
+static void indexBreakTable(struct GGGGC_Pool *pool)
+{
+    struct BreakTableEl *breakTable = (struct BreakTableEl *) pool->breakTable;
+    ggc_size_t card, i = 0;
+
+    for (card = 0; card < GGGGC_CARDS_PER_POOL; card++) {
+        ggc_size_t *cardStart = (ggc_size_t *) ((char *) pool + card * GGGGC_CARD_BYTES);
+        while (i < pool->breakTableSize && breakTable[i].orig < cardStart) i++;
+        pool->breakTableIndex[card] = i;
+    }
+    pool->breakTableIndex[card] = pool->breakTableSize;
+}
+
+/* find the break table entry that matches a given pointer */
+static struct BreakTableEl *findBreakTableEntry(ggc_size_t *loc)
+{
+    struct GGGGC_Pool *pool = GGGGC_POOL_OF(loc);
+    struct BreakTableEl *breakTable = (struct BreakTableEl *) pool->breakTable;
+    ggc_size_t card, lo, hi, mid;
+
+    if (pool->breakTableSize == 0) return NULL;
+
+    /* the entry is the last one at or before loc, so it's either in loc's card
+     * or is the last entry before it */
+    card = GGGGC_CARD_OF(loc);
+    lo = pool->breakTableIndex[card];
+    hi = pool->breakTableIndex[card + 1];
+    if (lo == hi || breakTable[lo].orig > loc)
+        return lo ? &breakTable[lo - 1] : NULL;
+
+    /* usually there are very few entries per card, but search them anyway */
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (breakTable[mid].orig <= loc)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return &breakTable[lo];
+}
+
+#else /* !GGGGC_BREAK_TABLE_COMPACTION */
+/* Sliding compaction. Once marking is done, each pool's mark bits are extended
+ * to cover every word of its live objects, and the number of live words before
+ * each block of mark bits is recorded. An object's new location is then the
+ * start of its pool plus the live words before it, found with one lookup and
+ * one population count. Every pointer is updated before anything moves, and
+ * then each pool slides its objects down. */
+
+/* find the new location of an object that's been compacted */
+static ggc_size_t *compactedLocation(ggc_size_t *obj)
+{
+    struct GGGGC_Pool *pool = GGGGC_POOL_OF(obj);
+    ggc_size_t word = MARK_WORD(obj);
+    ggc_size_t block = word / GGGGC_BITS_PER_WORD;
+    ggc_size_t below = ((ggc_size_t) 1 << (word % GGGGC_BITS_PER_WORD)) - 1;
+
+    return pool->start + pool->compactOffsets[block] +
+        POPCOUNT(pool->markBits[block] & below);
+}
+
+#define FOLLOW_COMPACTED_OBJECT(obj) do { \
+    ggc_size_t *dobj = compactedLocation((ggc_size_t *) (obj)); \
+    obj = dobj; \
+} while(0)
+
+#endif /* GGGGC_BREAK_TABLE_COMPACTION */
+
+/* the pools being compacted, which workers claim one at a time */
+static struct GGGGC_Pool **compactPools;
+static ggc_size_t compactPoolsUsed, compactPoolsSize;
+static volatile ggc_size_t compactNext;
+
+
+/* mark the pointers in words [from, to) of an object */
+static void markRange(struct Worker *w, struct GGGGC_Header *obj,
+                      struct GGGGC_Descriptor *descriptor,
+                      ggc_size_t from, ggc_size_t to)
+{
+    void **objVp = (void **) obj;
+    ggc_size_t curWord;
+#ifndef GGGGC_FEATURE_EXTTAG
+    ggc_size_t curDescription;
+
+    curDescription = descriptor->pointers[from / GGGGC_BITS_PER_WORD] >>
+        (from % GGGGC_BITS_PER_WORD);
+    for (curWord = from; curWord < to; curWord++) {
+        if (curWord % GGGGC_BITS_PER_WORD == 0)
+            curDescription = descriptor->pointers[curWord / GGGGC_BITS_PER_WORD];
+        if ((curDescription & 1) && objVp[curWord] && !IS_TAGGED(objVp[curWord]))
+            WORK_PUSH(w, &objVp[curWord]);
+        curDescription >>= 1;
+    }
+
+#else
+    for (curWord = from; curWord < to; curWord++) {
+        if ((descriptor->tags[curWord] & 1) == 0)
+            WORK_PUSH(w, &objVp[curWord]);
+    }
+
+#endif
+}
+
+/* mark one chunk of a large object, leaving the rest to be stolen */
+static void markChunk(struct Worker *w, struct GGGGC_Header *obj, ggc_size_t from)
+{
+    struct GGGGC_Descriptor *descriptor = obj->descriptor__ptr;
+    ggc_size_t to = from + MARK_CHUNK_WORDS;
+
+    if (to < descriptor->size)
+        WORK_PUSH_CHUNK(w, obj, to);
+    else
+        to = descriptor->size;
+
+    markRange(w, obj, descriptor, from, to);
+}
+
+/* add a marked object's pointers to be marked, a chunk at a time if it's big */
+static void markScan(struct Worker *w, struct GGGGC_Header *obj)
+{
+    struct GGGGC_Descriptor *descriptor = obj->descriptor__ptr;
+
+#define MARK_ADD(ptr) WORK_PUSH(w, ptr)
+    if (descriptor->size > MARK_CHUNK_WORDS &&
+#ifndef GGGGC_FEATURE_EXTTAG
+        (descriptor->pointers[0] & 1)
+#else
+        descriptor->tags[0] != 1
+#endif
+        ) {
+        WORK_PUSH(w, (void *) &obj->descriptor__ptr);
+        WORK_PUSH_CHUNK(w, obj, 1);
+    } else {
+        SCAN_OBJECT_POINTERS(obj, descriptor, MARK_ADD);
+    }
+#undef MARK_ADD
+}
+
+/* marking phase of a full collection, run by every worker */
+static void markPhase(ggc_size_t workerId)
+{
+    struct Worker *w = workers[workerId];
+    void *item;
 
-            /* mark it as forwarded */
-            obj->descriptor__ptr = (struct GGGGC_Descriptor *) (((ggc_size_t) nobj) | 1);
-            *ptr = obj = nobj;
+    while (workNext(workerId, &item)) {
+        void **ptr;
+        struct GGGGC_Header *obj;
 
-            /* and add its pointers */
-            ADD_OBJECT_POINTERS(obj, obj->descriptor__ptr);
+        if ((ggc_size_t) item & 1) {
+            /* a chunk of a large object */
+            ggc_size_t from = (ggc_size_t) w->cur->buf[--w->cur->used];
+            markChunk(w, (struct GGGGC_Header *) ((ggc_size_t) item & (ggc_size_t) ~1), from);
+            continue;
         }
 
-#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
-        /* check for post-corruption */
-        if (obj->ggggc_memoryCorruptionCheck != GGGGC_MEMORY_CORRUPTION_VAL) {
-            fprintf(stderr, "GGGGC: Memory corruption (postcheck)!\n");
-            abort();
+        ptr = (void **) item;
+        obj = (struct GGGGC_Header *) *ptr;
+        if (obj == NULL) continue;
+
+        /* if the object has moved */
+        if (IS_FORWARDED_OBJECT(obj)) {
+            /* then follow it */
+            FOLLOW_FORWARDED_OBJECT(obj);
+            *ptr = (void *) obj;
         }
-#endif
 
-#ifdef GGGGC_FEATURE_FINALIZERS
-        /* perhaps check finalizers */
-        if (!toSearch->used && !finalizersChecked) {
-            GGGGC_FinalizerEntry finalizer = NULL, nextFinalizer = NULL;
+        /* mark it, unless it's already marked, and add its pointers */
+        if (IS_MARKED(obj) || !markAtomic(obj)) continue;
+        markScan(w, obj);
+    }
+}
 
-            finalizersChecked = 1;
+#ifdef GGGGC_SNAPSHOT_MARKING
+/* finish concurrent marking, whose marks are already in place: leave what it
+ * didn't get to (or couldn't know about) on this worker's stack for markPhase */
+static void concurrentFinish(struct Worker *w)
+{
+    struct GGGGC_Pool *poolCur;
+    struct GGGGC_Header *obj;
+    struct GGGGC_Descriptor *descriptor;
+    struct LogBuffer *buf;
+    ggc_size_t *cur, i;
+
+#define MARK_ADD(ptr) WORK_PUSH(w, ptr)
+    for (poolCur = ggggc_gens[1]; poolCur; poolCur = poolCur->next) {
+        for (cur = poolCur->start; cur < poolCur->free; cur += descriptor->size) {
+            obj = (struct GGGGC_Header *) cur;
+            descriptor = obj->descriptor__ptr;
+
+            if (cur >= poolCur->markTop) {
+                /* promoted while marking, so live, but never scanned */
+                MARK(obj);
+                SCAN_OBJECT_POINTERS(obj, descriptor, MARK_ADD);
+
+            } else if (IS_MARKED(obj)) {
+                /* it may have been given young pointers since it was scanned */
+                if (poolCur->remember[GGGGC_CARD_OF(obj)])
+                    SCAN_OBJECT_POINTERS(obj, descriptor, MARK_ADD);
 
-            /* add all the finalizers themselves */
-            for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
-                for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-                    FINALIZER_POOL();
-                }
-            }
-            for (genCur = 1; genCur <= gen; genCur++) {
-                for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-                    FINALIZER_POOL();
-                }
             }
-
-            /* then make sure the finalizer queues get promoted */
-            TOSEARCH_ADD(&survivingFinalizers);
-            TOSEARCH_ADD(&survivingFinalizersTail);
-            TOSEARCH_ADD(&readyFinalizers);
         }
-#endif /* GGGGC_FEATURE_FINALIZERS */
     }
-#endif /* GGGGC_GENERATIONS > 1 */
-
-postCollect:
+#undef MARK_ADD
 
-#ifdef GGGGC_FEATURE_FINALIZERS
-    /* preserve surviving finalizers */
-    if (survivingFinalizers) {
-        poolCur = GGGGC_POOL_OF(survivingFinalizers);
-        poolCur->finalizers = survivingFinalizers;
+    /* and likewise the large objects */
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next) {
+        obj = (struct GGGGC_Header *) poolCur->start;
+        if (poolCur->start >= poolCur->markTop) {
+            MARK(obj);
+            markScan(w, obj);
+        } else if (IS_MARKED(obj) && poolCur->remember[GGGGC_CARD_OF(obj)]) {
+            markScan(w, obj);
+        }
     }
-#endif
 
-    /* heuristically expand too-small generations */
-    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next)
-        ggggc_expandPoolList(plCur->pool, newPoolGenProto, 1);
-    for (genCur = 1; genCur <= gen; genCur++)
-        ggggc_expandPoolList(ggggc_gens[genCur], newPoolGenProto, 1);
+    /* grey objects haven't been scanned at all */
+    for (i = 0; i < concurrentGreyUsed; i++)
+        markScan(w, concurrentGrey[i]);
 
-    /* clear out the now-empty generations, unless we did a full collection */
-    if (gen < GGGGC_GENERATIONS - 1) {
-        for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
-            for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-                poolCur->free = poolCur->start;
-            }
-        }
-        ggggc_pool0 = ggggc_gen0;
-#if GGGGC_GENERATIONS > 1
-        for (genCur = 1; genCur <= gen; genCur++) {
-            for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-                memset(poolCur->remember, 0, GGGGC_CARDS_PER_POOL);
-                poolCur->free = poolCur->start;
-            }
-            ggggc_pools[genCur] = ggggc_gens[genCur];
+    /* and logged pointers may not have been marked */
+    for (buf = satbFull; buf; buf = buf->next) {
+        for (i = 0; i < buf->used; i++) {
+            obj = (struct GGGGC_Header *) buf->buf[i];
+            if (obj && !IS_TAGGED(obj) && GGGGC_POOL_OF(obj)->gen)
+                WORK_PUSH(w, &buf->buf[i]);
         }
+    }
 
-        /* and the remembered sets */
-        for (poolCur = ggggc_gens[gen+1]; poolCur; poolCur = poolCur->next) {
-            memset(poolCur->remember, 0, GGGGC_CARDS_PER_POOL);
+#ifdef GGGGC_SLOT_LOGGING
+    /* logged slots may have been given young pointers since they were scanned */
+    for (buf = slotLogFull; buf; buf = buf->next) {
+        for (i = 0; i < buf->used; i++) {
+            void **slot = (void **) buf->buf[i];
+            if (*slot && !IS_TAGGED(*slot))
+                WORK_PUSH(w, slot);
         }
-#endif
     }
-
-#ifdef GGGGC_DEBUG_REPORT_COLLECTIONS
-    report(gen, "post-collection");
+#endif
+}
 #endif
 
-#ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
-    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
-        for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-            memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
+/* add a pool to be compacted */
+static void compactPoolAdd(struct GGGGC_Pool *pool)
+{
+    if (compactPoolsUsed == compactPoolsSize) {
+        compactPoolsSize = compactPoolsSize ? compactPoolsSize * 2 : 64;
+        compactPools = (struct GGGGC_Pool **)
+            realloc(compactPools, compactPoolsSize * sizeof(struct GGGGC_Pool *));
+        if (compactPools == NULL) {
+            perror("realloc");
+            abort();
         }
     }
-    for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
-        for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-            memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
+    compactPools[compactPoolsUsed++] = pool;
+}
+
+#ifndef GGGGC_BREAK_TABLE_COMPACTION
+/* extend the mark bits over every live word, and count the live words before
+ * each block */
+static void compactSummarize(struct GGGGC_Pool *pool)
+{
+    ggc_size_t *bits = pool->markBits;
+    ggc_size_t word = pool->start - (ggc_size_t *) pool;
+    ggc_size_t limit = pool->free - (ggc_size_t *) pool;
+    ggc_size_t end, block, bit, live;
+
+    /* only the first word of each live object is marked */
+    while ((word = nextMarkBit(bits, word, limit, 1)) < limit) {
+        end = word + ((struct GGGGC_Header *) ((ggc_size_t *) pool + word))->descriptor__ptr->size;
+        for (word++; word < end; word += GGGGC_BITS_PER_WORD - bit) {
+            block = word / GGGGC_BITS_PER_WORD;
+            bit = word % GGGGC_BITS_PER_WORD;
+            if (end - word >= GGGGC_BITS_PER_WORD - bit)
+                bits[block] |= (ggc_size_t) -1 << bit;
+            else
+                bits[block] |= (((ggc_size_t) 1 << (end - word)) - 1) << bit;
         }
+        word = end;
     }
-    memoryCorruptionCheck("post-collection");
-#endif
-
-    /* free the other threads */
-    ggc_barrier_wait_raw(&ggggc_worldBarrier);
-    ggc_mutex_unlock(&ggggc_worldBarrierLock);
 
-#ifdef GGGGC_FEATURE_FINALIZERS
-    /* run our finalizers */
-    if (readyFinalizers)
-        ggggc_runFinalizers(readyFinalizers);
-#endif
+    live = 0;
+    for (block = 0; block * GGGGC_BITS_PER_WORD < limit; block++) {
+        pool->compactOffsets[block] = live;
+        live += POPCOUNT(bits[block]);
+    }
+    pool->survivors += live;
 }
 
-/* type for an element of our break table */
-struct BreakTableEl {
-    ggc_size_t *orig, *newL;
-};
+/* update every pointer in a pool's live objects, and work out its cards'
+ * metadata for after it's slid */
+static void compactUpdate(struct GGGGC_Pool *pool)
+{
+    ggc_size_t *bits = pool->markBits;
+    ggc_size_t word = pool->start - (ggc_size_t *) pool;
+    ggc_size_t limit = pool->free - (ggc_size_t *) pool;
+    ggc_size_t *to = pool->start;
+    struct GGGGC_Header *obj;
+    struct GGGGC_Descriptor *descriptor;
+#if GGGGC_GENERATIONS > 1
+    ggc_size_t card = 0, lastCard = (ggc_size_t) -1;
 
-/* mark an object */
-#define MARK(obj) do { \
-    struct GGGGC_Header *hobj = (obj); \
-    hobj->descriptor__ptr = (struct GGGGC_Descriptor *) \
-        ((ggc_size_t) hobj->descriptor__ptr | 2); \
+    /* this is going to fill in the remembered sets */
+    if (pool->gen) clearRemembered(pool);
+
+#define COMPACT_UPDATE(ptr) do { \
+    void **uptr = (void **) (ptr); \
+    if (*uptr) { \
+        FOLLOW_COMPACTED_OBJECT(*uptr); \
+        /* if it's a cross-generational pointer, remember it */ \
+        if (GGGGC_POOL_OF(*uptr)->gen < pool->gen) \
+            REMEMBER_CARD(pool, card); \
+    } \
+} while (0)
+#else
+#define COMPACT_UPDATE(ptr) do { \
+    void **uptr = (void **) (ptr); \
+    if (*uptr) FOLLOW_COMPACTED_OBJECT(*uptr); \
 } while (0)
+#endif
 
-/* unmark a pointer */
-#define UNMARK_PTR(type, ptr) \
-    ((type *) ((ggc_size_t) (ptr) & (ggc_size_t) ~2))
+    while ((word = nextMarkBit(bits, word, limit, 1)) < limit) {
+        obj = (struct GGGGC_Header *) ((ggc_size_t *) pool + word);
+        descriptor = obj->descriptor__ptr;
 
-/* get an object's descriptor, through markers */
-#define MARKED_DESCRIPTOR(obj) \
-    (UNMARK_PTR(struct GGGGC_Descriptor, (obj)->descriptor__ptr))
+#if GGGGC_GENERATIONS > 1
+        /* set its card metadata, at its new location */
+        if (pool->gen) {
+            card = GGGGC_CARD_OF(to);
+            if (card != lastCard) {
+                pool->firstObject[card] = ((ggc_size_t) to & GGGGC_CARD_INNER_MASK) / sizeof(ggc_size_t);
+                lastCard = card;
+            }
+        }
+#endif
 
-/* unmark an object */
-#define UNMARK(obj) do { \
-    struct GGGGC_Header *hobj = (obj); \
-    hobj->descriptor__ptr = UNMARK_PTR(struct GGGGC_Descriptor, hobj->descriptor__ptr); \
-} while (0)
+        SCAN_OBJECT_POINTERS(obj, descriptor, COMPACT_UPDATE);
+        word += descriptor->size;
+        to += descriptor->size;
+    }
+#undef COMPACT_UPDATE
 
-/* is this pointer marked? */
-#define IS_MARKED_PTR(ptr) ((ggc_size_t) (ptr) & 2)
+#if GGGGC_GENERATIONS > 1
+    /* and perhaps set firstObject for the free space */
+    if (pool->gen) {
+        card = GGGGC_CARD_OF(to);
+        if (card != lastCard)
+            pool->firstObject[card] = ((ggc_size_t) to & GGGGC_CARD_INNER_MASK) / sizeof(ggc_size_t);
+    }
+#endif
+}
 
-/* is this object marked? */
-#define IS_MARKED(obj) IS_MARKED_PTR((obj)->descriptor__ptr)
+/* slide a pool's live objects down, and clear its mark bits */
+static void compactSlide(struct GGGGC_Pool *pool)
+{
+    ggc_size_t *bits = pool->markBits;
+    ggc_size_t word = pool->start - (ggc_size_t *) pool;
+    ggc_size_t limit = pool->free - (ggc_size_t *) pool;
+    ggc_size_t *to = pool->start;
+    ggc_size_t end;
+
+    while ((word = nextMarkBit(bits, word, limit, 1)) < limit) {
+        end = nextMarkBit(bits, word, limit, 0);
+        if ((ggc_size_t *) pool + word != to)
+            memmove(to, (ggc_size_t *) pool + word, (end - word) * sizeof(ggc_size_t));
+        to += end - word;
+        word = end;
+    }
 
-/* find the new location of an object that's been compacted */
-#define FOLLOW_COMPACTED_OBJECT(obj) do { \
-    ggc_size_t *dobj = (ggc_size_t *) (obj); \
-    struct GGGGC_Pool *cpool = GGGGC_POOL_OF(dobj); \
-    struct BreakTableEl *bel = findBreakTableEntry( \
-        (struct BreakTableEl *) cpool->breakTable, cpool->breakTableSize, \
-        dobj); \
-    if (bel) { \
-        dobj -= bel->orig - bel->newL; \
-        obj = dobj; \
-    } \
-} while(0)
+    clearMarks(pool, pool->free);
+    pool->free = to;
+}
 
-/* special case for compacted descriptors */
-#define FOLLOW_COMPACTED_DESCRIPTOR(d) do { \
-    ggc_size_t *dcobj = (ggc_size_t *) (d); \
-    FOLLOW_COMPACTED_OBJECT(dcobj); \
-    d = (struct GGGGC_Descriptor *) dcobj; \
-} while(0)
+#endif /* !GGGGC_BREAK_TABLE_COMPACTION */
 
-/* comparator for break table elements */
-static int breakTableComparator(const void *lv, const void *rv)
+/* free the large objects that weren't marked */
+static void largeSweep()
 {
-    struct BreakTableEl *l, *r;
-    l = (struct BreakTableEl *) lv;
-    r = (struct BreakTableEl *) rv;
-    if (l->orig < r->orig) {
-        return -1;
-    } else if (l->orig > r->orig) {
-        return 1;
+    struct GGGGC_Pool *poolCur, **prev = &largePools;
+
+    largeAllocated = largeLive = 0;
+    while ((poolCur = *prev)) {
+        if (IS_MARKED((struct GGGGC_Header *) poolCur->start)) {
+            largeLive += poolCur->free - poolCur->start;
+            prev = &poolCur->next;
+        } else {
+            *prev = poolCur->next;
+            ggggc_freeLargePool(poolCur);
+        }
     }
-    return 0;
 }
 
-/* find the break table entry that matches a given pointer */
-static struct BreakTableEl *findBreakTableEntry(struct BreakTableEl *breakTable, ggc_size_t breakTableSize, ggc_size_t *loc)
+/* update the pointers in a surviving large object, which stays where it is,
+ * and clear its mark */
+static void largeUpdate(struct GGGGC_Pool *pool)
 {
-    ggc_size_t cur = breakTableSize / 2;
-    ggc_size_t step = cur / 2;
+    struct GGGGC_Header *obj = (struct GGGGC_Header *) pool->start;
+    struct GGGGC_Descriptor *descriptor = obj->descriptor__ptr;
 
-    if (breakTableSize == 0) return NULL;
-    if (step == 0) step = 1;
+#ifdef GGGGC_BREAK_TABLE_COMPACTION
+    /* its descriptor has already moved */
+    FOLLOW_COMPACTED_DESCRIPTOR(descriptor);
+#endif
 
-    while (1) {
-        if (breakTable[cur].orig <= loc) {
-            /* this might include the location being searched */
-            if (cur == breakTableSize - 1 ||
-                breakTable[cur+1].orig > loc)
-                return &breakTable[cur];
-
-            /* otherwise, we're too low */
-            cur += step;
-            if (cur >= breakTableSize) cur = breakTableSize - 1;
-            step /= 2;
-            if (step == 0) step = 1;
-
-        } else if (breakTable[cur].orig > loc) {
-            /* we're too high */
-            if (cur == 0) return NULL;
-            if (step > cur)
-                cur = 0;
-            else
-                cur -= step;
-            step /= 2;
-            if (step == 0) step = 1;
+#if GGGGC_GENERATIONS > 1
+    /* this is going to fill in the remembered set */
+    clearRemembered(pool);
+
+#define LARGE_UPDATE(ptr) do { \
+    void **uptr = (void **) (ptr); \
+    if (*uptr) { \
+        FOLLOW_COMPACTED_OBJECT(*uptr); \
+        /* if it's a cross-generational pointer, remember it */ \
+        if (GGGGC_POOL_OF(*uptr)->gen < pool->gen) \
+            REMEMBER_CARD(pool, GGGGC_CARD_OF(obj)); \
+    } \
+} while (0)
+#else
+#define LARGE_UPDATE(ptr) do { \
+    void **uptr = (void **) (ptr); \
+    if (*uptr) FOLLOW_COMPACTED_OBJECT(*uptr); \
+} while (0)
+#endif
+    SCAN_OBJECT_POINTERS(obj, descriptor, LARGE_UPDATE);
+#undef LARGE_UPDATE
 
-        }
-    }
+    MARK_BITS(obj) &= ~MARK_BIT(obj);
+}
+
+/* run a compaction step on every pool, in parallel */
+#define COMPACT_PHASE(phase, step) \
+static void phase(ggc_size_t workerId) \
+{ \
+    ggc_size_t i; \
+    while ((i = GGGGC_ATOMIC_ADD(&compactNext, 1) - 1) < compactPoolsUsed) \
+        step(compactPools[i]); \
+}
+#ifndef GGGGC_BREAK_TABLE_COMPACTION
+COMPACT_PHASE(compactSummarizePhase, compactSummarize)
+COMPACT_PHASE(compactUpdatePhase, compactUpdate)
+COMPACT_PHASE(compactSlidePhase, compactSlide)
+#else
+COMPACT_PHASE(countUsedPhase, ggggc_countUsed)
+COMPACT_PHASE(compactPhase, ggggc_compact)
+COMPACT_PHASE(postCompactPhase, ggggc_postCompact)
+#endif
+#undef COMPACT_PHASE
+
+static void compactRunParallel(void (*phase)(ggc_size_t))
+{
+    compactNext = 0;
+    runParallel(phase);
 }
 
 /* perform a full, in-place collection */
@@ -838,7 +2973,7 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
     struct GGGGC_Pool *poolCur;
     struct GGGGC_PointerStackList *pslCur;
     struct GGGGC_PointerStack *psCur;
-    struct ToSearch *toSearch;
+    struct Worker *w;
     unsigned char genCur;
     ggc_size_t i;
 #ifdef GGGGC_FEATURE_JITPSTACK
@@ -846,19 +2981,36 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
     void **jpsCur;
 #endif
 #ifdef GGGGC_FEATURE_FINALIZERS
-    int finalizersChecked = 0;
     GGGGC_FinalizerEntry survivingFinalizers, survivingFinalizersTail, readyFinalizers;
     survivingFinalizers = survivingFinalizersTail = readyFinalizers = NULL;
 #endif
 
-    TOSEARCH_INIT();
+    workersInit();
+    w = workers[0];
 
-    /* add our roots to the to-search list */
+#ifdef GGGGC_SURVIVOR_SPACES
+    /* survivors are compacted in place, wherever they were copied to */
+    survivorMerge();
+#endif
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+    /* take up where concurrent marking left off */
+    if (concurrentState != CONCURRENT_IDLE)
+        concurrentFinish(w);
+#endif
+
+#ifdef GGGGC_SLOT_LOGGING
+    /* objects are about to move, and compaction will remember the cards of
+     * any that still point to younger generations, so forget the log */
+    slotLogFilter(GGGGC_GENERATIONS - 1);
+#endif
+
+    /* add our roots to the collecting worker's work stack */
     for (pslCur = ggggc_rootPointerStackList; pslCur; pslCur = pslCur->next) {
         for (psCur = pslCur->pointerStack; psCur; psCur = psCur->next) {
             for (i = 0; i < psCur->size; i++) {
                 if (psCur->pointers[i] && !IS_TAGGED(*(void **) psCur->pointers[i]))
-                    TOSEARCH_ADD(psCur->pointers[i]);
+                    WORK_PUSH(w, psCur->pointers[i]);
             }
         }
     }
@@ -868,7 +3020,7 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
         for (jpsCur = jpslCur->cur; jpsCur < jpslCur->top; jpsCur++) {
 #ifndef GGGGC_FEATURE_EXTTAG
             if (!IS_TAGGED(*(void **) jpsCur))
-                TOSEARCH_ADD(jpsCur);
+                WORK_PUSH(w, jpsCur);
 #else
             int wordIdx;
             size_t tags = *((ggc_size_t *) jpsCur);
@@ -882,95 +3034,94 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
                 jpsCur++;
                 /* Lowest bit indicates pointer */
                 if ((tag & 0x1) == 0 && *jpsCur)
-                    TOSEARCH_ADD(jpsCur);
+                    WORK_PUSH(w, jpsCur);
             }
 #endif /* GGGGC_FEATURE_EXTTAG */
         }
     }
 #endif /* GGGGC_FEATURE_JITPSTACK */
 
-    /* now mark */
-    while (toSearch->used) {
-        void **ptr;
-        struct GGGGC_Header *obj;
-        ggc_size_t lastMark;
-
-        TOSEARCH_POP(void **, ptr);
-        obj = (struct GGGGC_Header *) *ptr;
-        if (obj == NULL) continue;
+    /* now mark, in parallel */
+    workActive = workerCount;
+    runParallel(markPhase);
 
-        lastMark = IS_MARKED_PTR(obj);
-        obj = UNMARK_PTR(struct GGGGC_Header, obj);
+#ifdef GGGGC_FEATURE_FINALIZERS
+    /* handle finalizers */
+    {
+        GGGGC_FinalizerEntry finalizer = NULL, nextFinalizer = NULL;
+        struct GGGGC_Header *obj;
 
-        /* if the object has moved */
-        if (IS_FORWARDED_OBJECT(obj)) {
-            /* then follow it */
-            FOLLOW_FORWARDED_OBJECT(obj);
-            *ptr = (void *) ((ggc_size_t) obj | lastMark);
+        /* sort all the finalizers by whether their objects survived */
+        for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
+            for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
+                FINALIZER_POOL();
+            }
         }
-
-        /* if the object isn't already marked... */
-        if (!IS_MARKED(obj)) {
-            struct GGGGC_Descriptor *descriptor = obj->descriptor__ptr;
-
-            /* then mark it */
-            MARK(obj);
-            GGGGC_POOL_OF(obj)->survivors += descriptor->size;
-
-            /* add its pointers */
-            ADD_OBJECT_POINTERS(obj, descriptor);
+        for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
+            for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
+                FINALIZER_POOL();
+            }
         }
+#ifdef GGGGC_SURVIVOR_SPACES
+        for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+            FINALIZER_POOL();
+        }
+#endif
 
-#ifdef GGGGC_FEATURE_FINALIZERS
-        /* possibly start handling finalizers */
-        if (!toSearch->used && !finalizersChecked) {
-            GGGGC_FinalizerEntry finalizer = NULL, nextFinalizer = NULL;
-
-            finalizersChecked = 1;
-
-            /* add all the finalizers themselves */
-            for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
-                for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-                    FINALIZER_POOL();
-                }
+        /* then make sure the finalizer queues survive */
+        WORK_PUSH(w, &survivingFinalizers);
+        WORK_PUSH(w, &survivingFinalizersTail);
+        WORK_PUSH(w, &readyFinalizers);
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+        /* concurrent marking may have marked entries without scanning them,
+         * and we've just relinked them anyway */
+        if (concurrentState != CONCURRENT_IDLE) {
+            for (finalizer = survivingFinalizers; finalizer; finalizer = finalizer->next__ptr) {
+                WORK_PUSH(w, (void *) &finalizer->next__ptr);
+                WORK_PUSH(w, (void *) &finalizer->obj__ptr);
             }
-            for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
-                for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-                    FINALIZER_POOL();
-                }
+            for (finalizer = readyFinalizers; finalizer; finalizer = finalizer->next__ptr) {
+                WORK_PUSH(w, (void *) &finalizer->next__ptr);
+                WORK_PUSH(w, (void *) &finalizer->obj__ptr);
             }
-
-            /* then make sure the finalizer queues get promoted */
-            TOSEARCH_ADD(&survivingFinalizers);
-            TOSEARCH_ADD(&survivingFinalizersTail);
-            TOSEARCH_ADD(&readyFinalizers);
         }
-#endif /* GGGGC_FEATURE_FINALIZERS */
+#endif
+        workActive = workerCount;
+        runParallel(markPhase);
     }
+#endif /* GGGGC_FEATURE_FINALIZERS */
 
-    /* find all our sizes, for later compaction */
+    /* large objects aren't compacted, just freed if they're dead */
+    largeSweep();
+
+    /* gather the pools to compact */
+    compactPoolsUsed = 0;
     for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
         for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-            ggggc_countUsed(poolCur);
+            compactPoolAdd(poolCur);
         }
     }
     for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
         for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-            ggggc_countUsed(poolCur);
-        }
-    }
-    
-    /* perform compaction */
-    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
-        for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-            ggggc_compact(poolCur);
+            compactPoolAdd(poolCur);
         }
     }
-    for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
-        for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-            ggggc_compact(poolCur);
-        }
+#ifdef GGGGC_SURVIVOR_SPACES
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+        compactPoolAdd(poolCur);
     }
+#endif
+
+#ifndef GGGGC_BREAK_TABLE_COMPACTION
+    /* find where everything will go */
+    compactRunParallel(compactSummarizePhase);
+
+#else
+    /* find all our sizes, then perform compaction */
+    compactRunParallel(countUsedPhase);
+    compactRunParallel(compactPhase);
+#endif
 
     /* then update our pointers */
     for (pslCur = ggggc_rootPointerStackList; pslCur; pslCur = pslCur->next) {
@@ -1023,17 +3174,17 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
 #undef F
 #endif
 
-    for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
-        for (poolCur = plCur->pool; poolCur; poolCur = poolCur->next) {
-            ggggc_postCompact(poolCur);
-        }
-    }
+    for (poolCur = largePools; poolCur; poolCur = poolCur->next)
+        largeUpdate(poolCur);
 
-    for (genCur = 1; genCur < GGGGC_GENERATIONS; genCur++) {
-        for (poolCur = ggggc_gens[genCur]; poolCur; poolCur = poolCur->next) {
-            ggggc_postCompact(poolCur);
-        }
-    }
+#ifndef GGGGC_BREAK_TABLE_COMPACTION
+    /* update the heap's pointers, then move everything */
+    compactRunParallel(compactUpdatePhase);
+    compactRunParallel(compactSlidePhase);
+
+#else
+    compactRunParallel(postCompactPhase);
+#endif
 
     /* reset the pools */
     ggggc_pool0 = ggggc_gen0;
@@ -1043,6 +3194,11 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
         }
         ggggc_pools[genCur] = ggggc_gens[genCur];
     }
+    allocSitesReset();
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+    concurrentEnd();
+#endif
 
 #ifdef GGGGC_DEBUG_MEMORY_CORRUPTION
     for (plCur = ggggc_rootPool0List; plCur; plCur = plCur->next) {
@@ -1055,6 +3211,11 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
             memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
         }
     }
+#ifdef GGGGC_SURVIVOR_SPACES
+    for (poolCur = survivorPools; poolCur; poolCur = poolCur->next) {
+        memset(poolCur->free, 0, (poolCur->end - poolCur->free) * sizeof(ggc_size_t));
+    }
+#endif
 #endif
 
 #ifdef GGGGC_FEATURE_FINALIZERS
@@ -1064,6 +3225,7 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
 #endif
 }
 
+#ifdef GGGGC_BREAK_TABLE_COMPACTION
 /* determine the size of every contiguous chunk of used or unused space in this
  * pool, and leave it visible in the pool:
  *
@@ -1072,6 +3234,7 @@ void ggggc_collectFull(COLLECT_FULL_ARGS)
  * * The size of each unused chunk is stored at the first word of that chunk 
  * * The size of each used chunk is stored before the first word of that chunk
  *   (i.e., in the unused space)
+ * * The total size of used chunks is added to the pool's survivors
  */
 void ggggc_countUsed(struct GGGGC_Pool *pool)
 {
@@ -1080,28 +3243,20 @@ void ggggc_countUsed(struct GGGGC_Pool *pool)
     /* first figure out the size of the first chunk of memory */
     for (cur = pool->start; 
          cur < pool->free && IS_MARKED((struct GGGGC_Header *) cur);
-         cur += ((struct GGGGC_Header *) cur)->descriptor__ptr->size) {
-        UNMARK((struct GGGGC_Header *) cur);
-    }
+         cur += ((struct GGGGC_Header *) cur)->descriptor__ptr->size);
     pool->breakTableSize = cur - pool->start;
-    if (cur >= pool->end) return;
+    pool->survivors += pool->breakTableSize;
+    if (cur >= pool->end) {
+        clearMarks(pool, pool->free);
+        return;
+    }
 
     while (1) {
-        /* we are currently in an UNUSED chunk. Find out how big it is */
-        for (next = cur;
-             next < pool->free && !IS_MARKED((struct GGGGC_Header *) next);) {
-            struct GGGGC_Header *obj = (struct GGGGC_Header *) next;
-
-            /* if it's unmarked, it may even have moved */
-            if (IS_FORWARDED_OBJECT(obj)) {
-                /* we'll need to find its descriptor */
-                FOLLOW_FORWARDED_OBJECT(obj);
-                /* we don't need to follow the descriptor if it moved, as the
-                 * old data is still intact */
-            }
-
-            next += MARKED_DESCRIPTOR(obj)->size;
-        }
+        /* we are currently in an UNUSED chunk. It ends at the next marked
+         * object, so we never read the dead objects in it, which may have been
+         * forwarded to pools that other workers are counting */
+        next = (ggc_size_t *) pool + nextMarkBit(pool->markBits,
+            cur - (ggc_size_t *) pool, pool->free - (ggc_size_t *) pool, 1);
         if (next >= pool->free) next = pool->end;
 
         /* mark its size */
@@ -1112,15 +3267,17 @@ void ggggc_countUsed(struct GGGGC_Pool *pool)
         /* we are currently in a USED chunk. Find out how big it is */
         for (next = cur;
              next < pool->free && IS_MARKED((struct GGGGC_Header *) next);
-             next += ((struct GGGGC_Header *) next)->descriptor__ptr->size) {
-            UNMARK((struct GGGGC_Header *) next);
-        }
+             next += ((struct GGGGC_Header *) next)->descriptor__ptr->size);
 
         /* mark its size */
         cur[-1] = next - cur;
+        pool->survivors += next - cur;
         cur = next;
         if (next >= pool->end) break;
     }
+
+    /* the marks are no longer needed */
+    clearMarks(pool, pool->free);
 }
 
 /* compact a pool and create its break table */
@@ -1184,23 +3341,30 @@ void ggggc_compact(struct GGGGC_Pool *pool)
     pool->breakTableSize = btEnd - bt;
     pool->breakTable = bt;
 
-    /* then sort the break table */
+    /* then sort and index the break table */
     qsort(bt, pool->breakTableSize, sizeof(struct BreakTableEl), breakTableComparator);
+    indexBreakTable(pool);
 }
 
 /* reset all the pointers in a pool after compaction */
 void ggggc_postCompact(struct GGGGC_Pool *pool)
 {
-    ggc_size_t **obj;
+    ggc_size_t **obj, **next;
+    struct GGGGC_Descriptor *descriptor, *nextDescriptor = NULL;
     ggc_size_t card = 0, lastCard = (ggc_size_t) -1;
 
 #if GGGGC_GENERATIONS > 1
     /* this is going to fill in the remembered sets */
-    if (pool->gen) memset(pool->remember, 0, GGGGC_CARDS_PER_POOL);
+    if (pool->gen) clearRemembered(pool);
 #endif
 
-    for (obj = (ggc_size_t **) pool->start; obj < (ggc_size_t **) pool->free;) {
-        struct GGGGC_Descriptor *descriptor;
+    obj = (ggc_size_t **) pool->start;
+    if (obj < (ggc_size_t **) pool->free) {
+        nextDescriptor = (struct GGGGC_Descriptor *) obj[0];
+        FOLLOW_COMPACTED_DESCRIPTOR(nextDescriptor);
+    }
+
+    while (obj < (ggc_size_t **) pool->free) {
         ggc_size_t curWord;
 #ifndef GGGGC_FEATURE_EXTTAG
         ggc_size_t curDescription = 0, curDescriptorWord = 0;
@@ -1217,9 +3381,15 @@ void ggggc_postCompact(struct GGGGC_Pool *pool)
         }
 #endif
 
-        /* get the descriptor */
-        descriptor = (struct GGGGC_Descriptor *) obj[0];
-        FOLLOW_COMPACTED_DESCRIPTOR(descriptor);
+        /* the descriptor was found with the last object, so find the next
+         * object's, and start on the lookups for its pointers */
+        descriptor = nextDescriptor;
+        next = obj + descriptor->size;
+        if (next < (ggc_size_t **) pool->free) {
+            nextDescriptor = (struct GGGGC_Descriptor *) next[0];
+            FOLLOW_COMPACTED_DESCRIPTOR(nextDescriptor);
+            SCAN_OBJECT_POINTERS(next, nextDescriptor, COMPACT_PREFETCH);
+        }
 
         /* and walk through all its pointers */
 #ifndef GGGGC_FEATURE_EXTTAG
@@ -1245,7 +3415,7 @@ void ggggc_postCompact(struct GGGGC_Pool *pool)
 #if GGGGC_GENERATIONS > 1
                     /* if it's a cross-generational pointer, remember it */
                     if (GGGGC_POOL_OF(obj[curWord])->gen < pool->gen)
-                        pool->remember[card] = 1;
+                        REMEMBER_CARD(pool, card);
 #endif
                 }
 #ifndef GGGGC_FEATURE_EXTTAG
@@ -1257,11 +3427,11 @@ void ggggc_postCompact(struct GGGGC_Pool *pool)
             FOLLOW_COMPACTED_OBJECT(obj[0]);
 #if GGGGC_GENERATIONS > 1
             if (GGGGC_POOL_OF(obj[0])->gen < pool->gen)
-                pool->remember[card] = 1;
+                REMEMBER_CARD(pool, card);
 #endif
         }
 
-        obj += descriptor->size;
+        obj = next;
     }
 
 #if GGGGC_GENERATIONS > 1
@@ -1280,7 +3450,7 @@ void ggggc_postCompact(struct GGGGC_Pool *pool)
             fprintf(stderr, "GGGGC: Memory corruption (post-compaction)\n");
             abort();
         }
-        if (IS_MARKED_PTR(descriptor->header.descriptor__ptr)) {
+        if (IS_MARKED((struct GGGGC_Header *) obj)) {
             fprintf(stderr, "GGGGC: Memory corruption (post-compaction surviving mark)\n");
             abort();
         }
@@ -1289,6 +3459,8 @@ void ggggc_postCompact(struct GGGGC_Pool *pool)
 #endif
 }
 
+#endif /* GGGGC_BREAK_TABLE_COMPACTION */
+
 /* run a full collection of every generation */
 void ggggc_collect()
 {
@@ -1305,8 +3477,17 @@ int ggggc_yield()
 #ifdef GGGGC_FEATURE_JITPSTACK
     struct GGGGC_JITPointerStackList jitPointerStackNode;
 #endif
+    ggc_size_t workerId;
 
     if (ggggc_stopTheWorld) {
+#ifdef GGGGC_SNAPSHOT_MARKING
+        /* our logged pointers need to be visible to the collection */
+        ggggc_satbFlush();
+#endif
+#ifdef GGGGC_SLOT_LOGGING
+        ggggc_slotLogFlush();
+#endif
+
         /* wait for the barrier once to stop the world */
         ggc_barrier_wait_raw(&ggggc_worldBarrier);
 
@@ -1326,13 +3507,20 @@ int ggggc_yield()
         ggggc_rootJITPointerStackList = &jitPointerStackNode;
 #endif
 
+        /* and join the collection as a worker */
+#ifndef GGGGC_NO_PARALLEL_COLLECTION
+        workerId = workerCount++;
+#else
+        workerId = 0;
+#endif
+
         ggc_mutex_unlock(&ggggc_rootsLock);
 
         /* wait for the barrier once to allow collection */
         ggc_barrier_wait_raw(&ggggc_worldBarrier);
 
-        /* wait for the barrier to know when collection is done */
-        ggc_barrier_wait_raw(&ggggc_worldBarrier);
+        /* help with the collection until it's done */
+        workParallel(workerId);
 
         /* now we can reset our pool */
         ggggc_pool0 = ggggc_gen0;
@@ -32,14 +32,19 @@ struct FreeListNode {
 };
 static ggc_thread_local struct FreeListNode *freeList = NULL;
 
-/* create a pool and add it to the free list */
-static struct GGGGC_Pool *ggggc_newPoolFree(int mustSucceed)
+/* create a pool with room for at least size words and add it to the free
+ * list */
+static struct GGGGC_Pool *ggggc_newPoolFree(ggc_size_t size, int mustSucceed)
 {
     struct GGGGC_Pool *pool;
     struct FreeListNode *node;
 
-    /* allocate the pool */
-    pool = ggggc_newPool(mustSucceed);
+    /* allocate the pool, spanning several if it's for a very large object
+     * (with room to split off what's left over) */
+    if (size + GGGGC_WORD_SIZEOF(struct GGGGC_Pool) > GGGGC_WORDS_PER_POOL)
+        pool = ggggc_newLargePool(size + GGGGC_MINIMUM_OBJECT_SIZE + 1, mustSucceed);
+    else
+        pool = ggggc_newPool(mustSucceed);
     if (!pool) return NULL;
 
     /* make it into a free list node */
@@ -91,7 +96,7 @@ retry:
         /* Not enough space. Collect and maybe allocate more. */
         if (!ggggc_gen0) {
             /* We don't have any space at all! */
-            ggggc_gen0 = ggggc_pool0 = ggggc_newPoolFree(1);
+            ggggc_gen0 = ggggc_pool0 = ggggc_newPoolFree(size, 1);
             goto retry;
         }
 
@@ -104,12 +109,11 @@ retry:
             goto retry;
         }
 
-        /* Not enough space even after collection, so just make more. FIXME:
-         * What if it's too big for a pool? */
+        /* Not enough space even after collection, so just make more */
         if (retried < 2) {
             struct GGGGC_Pool *pool;
             retried = 2;
-            pool = ggggc_newPoolFree(0);
+            pool = ggggc_newPoolFree(size, 0);
             if (pool) {
                 pool->next = ggggc_gen0;
                 ggggc_gen0 = pool;
@@ -141,6 +145,17 @@ void *ggggc_malloc(struct GGGGC_Descriptor *descriptor)
     return ret;
 }
 
+/* this collector isn't generational, so there's nothing to pretenure */
+void *ggggc_mallocOld(struct GGGGC_Descriptor *descriptor)
+{
+    return ggggc_malloc(descriptor);
+}
+
+void *ggggc_mallocSite(struct GGGGC_AllocSite *site, struct GGGGC_Descriptor *descriptor)
+{
+    return ggggc_malloc(descriptor);
+}
+
 /* generalized stop-the-world */
 static void stopTheWorld(
     struct GGGGC_PoolList *pool0Node,
@@ -529,7 +544,7 @@ void clearFreeList()
         /* less than half free */
         total = survivors - (total - survivors) + GGGGC_POOL_BYTES;
         while (total > GGGGC_POOL_BYTES) {
-            pool = ggggc_newPoolFree(0);
+            pool = ggggc_newPoolFree(0, 0);
             if (!pool)
                 break;
             pool->next = ggggc_gen0;
@@ -662,6 +677,9 @@ void ggggc_collect0(unsigned char gen)
     memoryCorruptionCheck("post-collection");
 #endif
 
+    /* give back any pools that have been free for a while */
+    ggggc_releaseIdlePools();
+
     restartTheWorld();
 
     /* clear our freelist */
@@ -674,6 +692,12 @@ void ggggc_collect0(unsigned char gen)
 #endif
 }
 
+/* in the child of a fork: all of our state is protected by the world barrier
+ * lock, so there's nothing to forget */
+void ggggc_collectorForkChild()
+{
+}
+
 /* run full garbage collection (in gembc, just collect0) */
 void ggggc_collect()
 {
@@ -25,6 +25,26 @@
 extern "C" {
 #endif
 
+/* atomic operations, needed for parallel collection. Without them, the
+ * collector runs on only one thread, so plain operations suffice. */
+#if !defined(GGGGC_NO_THREADS) && defined(__GNUC__) && !defined(GGGGC_NO_GNUC_ATOMICS)
+#define GGGGC_CAS(ptr, oldv, newv) __sync_bool_compare_and_swap((ptr), (oldv), (newv))
+#define GGGGC_ATOMIC_ADD(ptr, val) __sync_add_and_fetch((ptr), (val))
+#define GGGGC_ATOMIC_SUB(ptr, val) __sync_sub_and_fetch((ptr), (val))
+#define GGGGC_MEMORY_BARRIER() __sync_synchronize()
+
+#else
+#ifndef GGGGC_NO_PARALLEL_COLLECTION
+#define GGGGC_NO_PARALLEL_COLLECTION 1
+#endif
+#define GGGGC_CAS(ptr, oldv, newv) \
+    ((*(ptr) == (oldv)) ? ((*(ptr) = (newv)), 1) : 0)
+#define GGGGC_ATOMIC_ADD(ptr, val) (*(ptr) += (val))
+#define GGGGC_ATOMIC_SUB(ptr, val) (*(ptr) -= (val))
+#define GGGGC_MEMORY_BARRIER() do {} while(0)
+
+#endif
+
 /* allocate an object, collecting if impossible. Descriptor is for protection
  * only */
 void *ggggc_mallocRaw(struct GGGGC_Descriptor **descriptor, ggc_size_t size);
@@ -32,23 +52,42 @@ void *ggggc_mallocRaw(struct GGGGC_Descriptor **descriptor, ggc_size_t size);
 /* allocate and initialize a pool */
 struct GGGGC_Pool *ggggc_newPool(int mustSucceed);
 
+/* allocate and initialize a pool for one object of size words, which may span
+ * several pools */
+struct GGGGC_Pool *ggggc_newLargePool(ggc_size_t size, int mustSucceed);
+
+/* free a pool from ggggc_newLargePool */
+void ggggc_freeLargePool(struct GGGGC_Pool *pool);
+
 /* allocate and initialize a pool, based on a prototype */
 struct GGGGC_Pool *ggggc_newPoolProto(struct GGGGC_Pool *pool);
 
-/* heuristically expand a pool list if it has too many survivors
- * poolList: Pool list to expand
- * newPool: Function to allocate a new pool based on a prototype pool
- * ratio: As a power of two, portion of pool that should be survivors */
-void ggggc_expandPoolList(struct GGGGC_Pool *poolList,
-                          struct GGGGC_Pool *(*newPool)(struct GGGGC_Pool *),
-                          int ratio);
-
 /* free a generation (used when a thread exits) */
 void ggggc_freeGeneration(struct GGGGC_Pool *proto);
 
+/* count a collection, and give the memory of long-free pools back to the
+ * system */
+void ggggc_releaseIdlePools(void);
+
 /* run a collection */
 void ggggc_collect0(unsigned char gen);
 
+/* reset the collector's state in the child of a fork, in which only the forking
+ * thread survives */
+void ggggc_collectorForkChild(void);
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+/* hand this thread's log of overwritten pointers to the marker (before
+ * blocking or exiting) */
+void ggggc_satbFlush(void);
+#endif
+
+#ifdef GGGGC_SLOT_LOGGING
+/* hand this thread's log of written slots to the collector (before blocking or
+ * exiting) */
+void ggggc_slotLogFlush(void);
+#endif
+
 /* ggggc_worldBarrierLock protects:
  *  ggggc_worldBarrier
  *  ggggc_threadCount
@@ -106,8 +145,10 @@ extern struct GGGGC_Pool *ggggc_gens[GGGGC_GENERATIONS];
 /* and each have their own allocation pool */
 extern struct GGGGC_Pool *ggggc_pools[GGGGC_GENERATIONS];
 
-/* descriptor descriptors */
-extern struct GGGGC_Descriptor *ggggc_descriptorDescriptors[GGGGC_WORDS_PER_POOL/GGGGC_BITS_PER_WORD+sizeof(struct GGGGC_Descriptor)];
+/* descriptor descriptors, by the size of the descriptors they describe */
+#define GGGGC_DESCRIPTOR_DESCRIPTORS \
+    (GGGGC_WORDS_PER_POOL/GGGGC_BITS_PER_WORD+sizeof(struct GGGGC_Descriptor))
+extern struct GGGGC_Descriptor *ggggc_descriptorDescriptors[GGGGC_DESCRIPTOR_DESCRIPTORS];
 
 /* and a lock for the descriptor descriptors */
 extern ggc_mutex_t ggggc_descriptorDescriptorsLock;
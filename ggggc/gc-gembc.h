@@ -22,41 +22,228 @@
 
 #define GGGGC_COLLECTOR_GEMBC 1
 
-/* pool members */
-#define GGGGC_COLLECTOR_POOL_MEMBERS_BREAK_TABLE \
+/* pool members for full collections */
+#ifdef GGGGC_BREAK_TABLE_COMPACTION
+#define GGGGC_COLLECTOR_POOL_MEMBERS_COMPACTION \
     /* size of the break table (in entries, used only during collection) */ \
     ggc_size_t breakTableSize; \
     \
     /* pointer to the break table (used only during collection) */ \
-    void *breakTable;
+    void *breakTable; \
+    \
+    /* for each card, the index of the first break table entry at or after it \
+     * (used only during collection) */ \
+    unsigned int breakTableIndex[GGGGC_CARDS_PER_POOL + 1];
+
+#else
+#define GGGGC_COLLECTOR_POOL_MEMBERS_COMPACTION \
+    /* number of live words before each block of mark bits (used only during \
+     * collection) */ \
+    unsigned int compactOffsets[GGGGC_WORDS_PER_POOL / GGGGC_BITS_PER_WORD];
+
+#endif
+
+#define GGGGC_COLLECTOR_POOL_MEMBERS_FULL \
+    GGGGC_COLLECTOR_POOL_MEMBERS_COMPACTION \
+    \
+    /* set if this pool holds a single large object, which is never moved */ \
+    unsigned char large; \
+    \
+    /* mark bits, one per word, so that marking never writes to objects. Clear \
+     * except during a full collection (or concurrent marking) */ \
+    ggc_size_t markBits[GGGGC_WORDS_PER_POOL / GGGGC_BITS_PER_WORD];
+
+/* concurrent and incremental marking share the snapshot machinery */
+#ifdef GGGGC_CONCURRENT_MARKING
+#ifdef GGGGC_NO_THREADS
+#error GGGGC_CONCURRENT_MARKING requires threads
+#endif
+#define GGGGC_SNAPSHOT_MARKING 1
+#endif
+#ifdef GGGGC_INCREMENTAL_MARKING
+#ifndef GGGGC_INCREMENTAL_BUDGET
+#define GGGGC_INCREMENTAL_BUDGET 1000 /* microseconds per pause */
+#endif
+#define GGGGC_SNAPSHOT_MARKING 1
+#endif
+
+#ifdef GGGGC_SNAPSHOT_MARKING
+#if GGGGC_GENERATIONS != 2
+#error GGGGC_CONCURRENT_MARKING and GGGGC_INCREMENTAL_MARKING require GGGGC_GENERATIONS=2
+#endif
+
+#define GGGGC_COLLECTOR_POOL_MEMBERS_CONCURRENT \
+    /* the free pointer when marking started. Everything above it was \
+     * allocated during marking, and so is live */ \
+    ggc_size_t *markTop;
+
+/* set while the old generation is being marked concurrently or incrementally */
+extern volatile int ggggc_concurrentMarking;
+
+/* log an overwritten pointer for the marker */
+void ggggc_satbLog(void *ptr);
+
+/* snapshot-at-the-beginning barrier: the overwritten value must be marked */
+#define GGGGC_WP_CONCURRENT(object, member) do { \
+    if (ggggc_concurrentMarking && (object)->member) \
+        ggggc_satbLog((void *) (object)->member); \
+} while(0)
+
+#else
+#define GGGGC_COLLECTOR_POOL_MEMBERS_CONCURRENT
+#define GGGGC_WP_CONCURRENT(object, member) do {} while(0)
+
+#endif
+
+#ifdef GGGGC_SLOT_LOGGING
+#if GGGGC_GENERATIONS < 2
+#error GGGGC_SLOT_LOGGING requires GGGGC_GENERATIONS > 1
+#endif
+
+#define GGGGC_COLLECTOR_POOL_MEMBERS_LOGGING \
+    /* the slots in this pool which the write barrier has logged */ \
+    ggc_size_t loggedBits[GGGGC_WORDS_PER_POOL / GGGGC_BITS_PER_WORD];
+
+/* log a slot of an old object which is being written to */
+void ggggc_slotLog(void *object, void *slot);
+
+/* slot-logging barrier: log the slot the first time it's written to */
+#define GGGGC_WP_REMEMBER(pool, o, slot) do { \
+    ggc_size_t ggggc_w = ((ggc_size_t) (slot) & GGGGC_POOL_INNER_MASK) / sizeof(ggc_size_t); \
+    if (!((pool)->loggedBits[ggggc_w / GGGGC_BITS_PER_WORD] & \
+          ((ggc_size_t) 1 << (ggggc_w % GGGGC_BITS_PER_WORD)))) \
+        ggggc_slotLog((void *) (o), (void *) (slot)); \
+} while(0)
+
+#else
+#define GGGGC_COLLECTOR_POOL_MEMBERS_LOGGING
+
+/* card-marking barrier */
+#define GGGGC_WP_REMEMBER(pool, o, slot) do { \
+    ggc_size_t ggggc_card = GGGGC_CARD_OF(o); \
+    (pool)->remember[ggggc_card] = 1; \
+    (pool)->rememberSummary[ggggc_card / GGGGC_CARDS_PER_SUMMARY] = 1; \
+} while(0)
+
+#endif
+
+#ifdef GGGGC_SURVIVOR_SPACES
+#if GGGGC_GENERATIONS < 2
+#error GGGGC_SURVIVOR_SPACES requires GGGGC_GENERATIONS > 1
+#endif
+#ifdef GGGGC_DEBUG_TINY_HEAP
+#error GGGGC_SURVIVOR_SPACES needs more pools than GGGGC_DEBUG_TINY_HEAP allows
+#endif
+#ifndef GGGGC_TENURING_THRESHOLD
+#define GGGGC_TENURING_THRESHOLD 4 /* most nursery collections before promotion */
+#endif
+
+#define GGGGC_COLLECTOR_POOL_MEMBERS_SURVIVOR \
+    /* for survivor pools, how many nursery collections their objects have \
+     * survived, and whether they're being evacuated into (0 for other pools) */ \
+    unsigned char age, toSpace; \
+    \
+    /* where the current collection's promotions into this pool began */ \
+    ggc_size_t *promoteStart;
+
+#else
+#define GGGGC_COLLECTOR_POOL_MEMBERS_SURVIVOR
+
+#endif
+
+/* allocation sites are pretenured once this many of their probed objects
+ * have been examined, and at least this percent of them survived */
+#ifndef GGGGC_PRETENURE_SAMPLES
+#define GGGGC_PRETENURE_SAMPLES 16
+#endif
+#ifndef GGGGC_PRETENURE_PERCENT
+#define GGGGC_PRETENURE_PERCENT 90
+#endif
+
+/* objects of at least this many words (which must be less than a pool) are
+ * each allocated in a large pool of their own, in the oldest generation, and
+ * never moved */
+#ifndef GGGGC_LARGE_OBJECT_WORDS
+#define GGGGC_LARGE_OBJECT_WORDS (GGGGC_WORDS_PER_POOL / 8)
+#endif
+
+/* heap sizing: the nursery is sized to keep minor collections within
+ * GGGGC_PAUSE_TARGET microseconds, and the heap is grown to keep the
+ * collector's share of the time within GGGGC_GC_OVERHEAD percent (0 for no
+ * target in either case), but the heap is kept between GGGGC_HEAP_MIN_POOLS
+ * and GGGGC_HEAP_MAX_POOLS pools (0 for no maximum) */
+#ifndef GGGGC_PAUSE_TARGET
+#define GGGGC_PAUSE_TARGET 0
+#endif
+#ifndef GGGGC_GC_OVERHEAD
+#define GGGGC_GC_OVERHEAD 0
+#endif
+#ifndef GGGGC_HEAP_MIN_POOLS
+#define GGGGC_HEAP_MIN_POOLS 0
+#endif
+#ifndef GGGGC_HEAP_MAX_POOLS
+#define GGGGC_HEAP_MAX_POOLS 0
+#endif
 
 #if GGGGC_GENERATIONS > 1
+/* the remembered set is summarized in groups of this many cards */
+#define GGGGC_CARDS_PER_SUMMARY 64
+#define GGGGC_SUMMARIES_PER_POOL \
+    ((GGGGC_CARDS_PER_POOL + GGGGC_CARDS_PER_SUMMARY - 1) / GGGGC_CARDS_PER_SUMMARY)
+
 #define GGGGC_COLLECTOR_POOL_MEMBERS \
     /* the remembered set for this pool. NOTE: It's important this be first to \
      * make assigning to the remembered set take one less operation */ \
     unsigned char remember[GGGGC_CARDS_PER_POOL]; \
     \
+    /* which groups of cards have any remembered, so clean groups can be \
+     * skipped without looking at their cards */ \
+    unsigned char rememberSummary[GGGGC_SUMMARIES_PER_POOL]; \
+    \
     /* the locations of objects within the cards */ \
     unsigned short firstObject[GGGGC_CARDS_PER_POOL]; \
     \
     /* the generation of this pool */ \
     unsigned char gen; \
     \
-    GGGGC_COLLECTOR_POOL_MEMBERS_BREAK_TABLE
+    GGGGC_COLLECTOR_POOL_MEMBERS_CONCURRENT \
+    GGGGC_COLLECTOR_POOL_MEMBERS_LOGGING \
+    GGGGC_COLLECTOR_POOL_MEMBERS_SURVIVOR \
+    GGGGC_COLLECTOR_POOL_MEMBERS_FULL
 
 #else
-#define GGGGC_COLLECTOR_POOL_MEMBERS GGGGC_COLLECTOR_POOL_MEMBERS_BREAK_TABLE
+#define GGGGC_COLLECTOR_POOL_MEMBERS GGGGC_COLLECTOR_POOL_MEMBERS_FULL
 
 #endif
 
-/* Due to our break tables, we must have at least three words in an object. This
- * is because we need one word at the end of a free space to store the size of
- * the next space, and two words to store a break table entry. */
+/* Due to our break tables (which remain available with
+ * GGGGC_BREAK_TABLE_COMPACTION), we must have at least three words in an
+ * object. This is because we need one word at the end of a free space to store
+ * the size of the next space, and two words to store a break table entry. */
 #undef GGGGC_MINIMUM_OBJECT_SIZE
 #define GGGGC_MINIMUM_OBJECT_SIZE 3
 
 /* write barriers */
 #if GGGGC_GENERATIONS > 1
+#ifdef GGGGC_FILTERING_BARRIER
+/* only remember stores of pointers to younger generations */
+#if defined(GGGGC_FEATURE_TAGGING)
+#define GGGGC_WP_YOUNGER(pool, value) \
+    ((value) && !((ggc_size_t) (value) & (sizeof(ggc_size_t)-1)) && \
+     GGGGC_GEN_OF(value) < (pool)->gen)
+#elif defined(GGGGC_FEATURE_EXTTAG)
+/* the value's tag isn't at hand, so it may not be a pointer at all */
+#define GGGGC_WP_YOUNGER(pool, value) (value)
+#else
+#define GGGGC_WP_YOUNGER(pool, value) \
+    ((value) && GGGGC_GEN_OF(value) < (pool)->gen)
+#endif
+
+#else
+#define GGGGC_WP_YOUNGER(pool, value) 1
+
+#endif
+
 #define GGGGC_WP(object, member, value) do { \
     ggc_size_t ggggc_o = (ggc_size_t) (object); \
     struct GGGGC_Pool *ggggc_pool = GGGGC_POOL_OF(ggggc_o); \
@@ -64,7 +251,9 @@
     GGGGC_ASSERT_ID(value); \
     if (ggggc_pool->gen) { \
         /* a high-gen object, let's remember it */ \
-        ggggc_pool->remember[GGGGC_CARD_OF(ggggc_o)] = 1; \
+        if (GGGGC_WP_YOUNGER(ggggc_pool, value)) \
+            GGGGC_WP_REMEMBER(ggggc_pool, ggggc_o, &(object)->member); \
+        GGGGC_WP_CONCURRENT(object, member); \
     } \
     (object)->member = (value); \
 } while(0)
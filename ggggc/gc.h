@@ -45,6 +45,8 @@ extern "C" {
 #ifdef GGGGC_NO_GNUC_FEATURES
 #define GGGGC_NO_GNUC_CLEANUP 1
 #define GGGGC_NO_GNUC_CONSTRUCTOR 1
+#define GGGGC_NO_GNUC_ATOMICS 1
+#define GGGGC_NO_GNUC_BUILTINS 1
 #endif
 
 /* word-sized integer type, usually size_t */
@@ -69,6 +71,10 @@ typedef char ggggc_size_t_check
 #define GGGGC_CARD_SIZE 12 /* also a power of 2 */
 #endif
 
+#ifndef GGGGC_POOL_IDLE_COLLECTIONS
+#define GGGGC_POOL_IDLE_COLLECTIONS 16 /* free pools are decommitted after this many collections */
+#endif
+
 /* various sizes and masks */
 #define GGGGC_WORD_SIZEOF(x) ((sizeof(x) + sizeof(ggc_size_t) - 1) / sizeof(ggc_size_t))
 #define GGGGC_POOL_BYTES ((ggc_size_t) 1 << GGGGC_POOL_SIZE)
@@ -134,6 +140,9 @@ struct GGGGC_Pool {
     /* how much survived the last collection */
     ggc_size_t survivors;
 
+    /* while it's free, the collection count when it was freed */
+    ggc_size_t freedAt;
+
 #ifdef GGGGC_FEATURE_FINALIZERS
     /* and pointer to the first finalizer in this pool */
     void *finalizers;
@@ -387,6 +396,41 @@ void *ggggc_mallocDataArray(ggc_size_t nmemb, ggc_size_t size);
 #define GGC_NEW_DA(type, size) \
     ((GGC_ ## type ## _Array) ggggc_mallocDataArray((size), sizeof(type)))
 
+/* allocation sites, for pretenuring. A site samples whether the objects it
+ * allocates survive their first collection, and once they consistently do,
+ * allocates directly in the old generation. Declare sites with
+ * GGC_ALLOC_SITE and allocate from them with GGC_NEW_AT. */
+#ifndef GGGGC_SITE_PROBES
+#define GGGGC_SITE_PROBES 8 /* objects sampled per site per collection */
+#endif
+struct GGGGC_AllocSite {
+    struct GGGGC_AllocSite *next; /* all sites that have allocated */
+    unsigned char registered, old;
+    ggc_size_t allocated; /* allocations since the last collection */
+    ggc_size_t sampled, survived; /* probes examined and how many survived */
+    void *probes[GGGGC_SITE_PROBES]; /* first objects since the last collection */
+};
+#define GGC_ALLOC_SITE(name) static struct GGGGC_AllocSite name
+
+/* allocate an object from an allocation site */
+void *ggggc_mallocSite(struct GGGGC_AllocSite *site, struct GGGGC_Descriptor *descriptor);
+
+/* allocate an object directly in the old generation, for data known to be
+ * long-lived */
+void *ggggc_mallocOld(struct GGGGC_Descriptor *descriptor);
+
+#ifdef GGGGC_DESCRIPTORS_CONSTRUCTED
+#define GGC_NEW_AT(type, site) \
+    ((type) ggggc_mallocSite(&(site), type ## __descriptorSlot.descriptor))
+#define GGC_NEW_OLD(type) \
+    ((type) ggggc_mallocOld(type ## __descriptorSlot.descriptor))
+#else
+#define GGC_NEW_AT(type, site) \
+    ((type) ggggc_mallocSite(&(site), ggggc_allocateDescriptorSlot(&type ## __descriptorSlot)))
+#define GGC_NEW_OLD(type) \
+    ((type) ggggc_mallocOld(ggggc_allocateDescriptorSlot(&type ## __descriptorSlot)))
+#endif
+
 /* allocate a descriptor for an object of the given size in words with the
  * given pointer layout */
 struct GGGGC_Descriptor *ggggc_allocateDescriptor(ggc_size_t size, ggc_size_t pointers);
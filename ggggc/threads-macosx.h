@@ -20,12 +20,14 @@
 #define GGGGC_THREADS_MACOSX_H 1
 
 #include <pthread.h>
+#include <sched.h>
 #include <dispatch/dispatch.h>
 
 /* functions */
 #define ggc_mutex_lock_raw              pthread_mutex_lock
 #define ggc_mutex_trylock               pthread_mutex_trylock
 #define ggc_mutex_unlock                pthread_mutex_unlock
+#define ggc_thread_yield                sched_yield
 
 /* types */
 #define ggc_mutex_t     pthread_mutex_t
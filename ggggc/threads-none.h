@@ -35,6 +35,7 @@
 #define ggc_sem_wait_raw(x)             0
 #define ggc_thread_create(x,y,z)        (-1)
 #define ggc_thread_join(x)              (-1)
+#define ggc_thread_yield()              0
 
 /* types */
 #define ggc_barrier_t   int
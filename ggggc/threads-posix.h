@@ -20,6 +20,7 @@
 #define GGGGC_THREADS_POSIX_H 1
 
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 
 /* functions */
@@ -35,6 +36,7 @@
 #define ggc_sem_init(x,y)               sem_init(x,0,y)
 #define ggc_sem_post                    sem_post
 #define ggc_sem_wait_raw                sem_wait
+#define ggc_thread_yield                sched_yield
 
 /* types */
 #if _POSIX_BARRIERS
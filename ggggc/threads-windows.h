@@ -25,6 +25,7 @@
 #define ggc_sem_init(sem,ct)            ((*(sem)=CreateSemaphore(NULL,0,(ct),NULL))?0:-1)
 #define ggc_sem_post(sem)               (!ReleaseSemaphore(*(sem),1,NULL))
 #define ggc_sem_wait_raw(sem)           (WaitForSingleObject(*(sem),INFINITE)==WAIT_FAILED)
+#define ggc_thread_yield()              (SwitchToThread(), 0)
 
 /* types */
 #define ggc_mutex_t     HANDLE
@@ -222,7 +222,7 @@ int main() {
         // Create a long lived object
         printf(" Creating a long-lived binary tree of depth %d\n",
                kLongLivedTreeDepth);
-          longLivedTree = GGC_NEW(Node);
+          longLivedTree = GGC_NEW_OLD(Node);
         Populate(kLongLivedTreeDepth, longLivedTree);
 
         // Create long-lived array, filling half of it
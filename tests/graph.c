@@ -36,6 +36,9 @@ static int prand()
     return (unsigned)(seed/65536) % 32768;
 }
 
+/* nodes mostly outlive a nursery collection */
+GGC_ALLOC_SITE(nodeSite);
+
 #define NODECT 1024
 #define ITERCT (1024*1024)
 
@@ -105,7 +108,7 @@ static void graph()
         int j = prand() % NODECT;
         node = GGC_RAP(nodes, j);
         if (!node || IS_TAGGED(node)) {
-            node = GGC_NEW(Node);
+            node = GGC_NEW_AT(Node, nodeSite);
             GGC_WAP(nodes, j, node);
 #ifdef GGGGC_FEATURE_FINALIZERS
             outstanding++;
@@ -119,7 +122,7 @@ static void graph()
         j = prand() % NODECT;
         next = GGC_RAP(nodes, j);
         if (!next || IS_TAGGED(next)) {
-            next = GGC_NEW(Node);
+            next = GGC_NEW_AT(Node, nodeSite);
             GGC_WAP(nodes, j, next);
 #ifdef GGGGC_FEATURE_FINALIZERS
             outstanding++;
@@ -65,6 +65,15 @@ else
 
         doTests "$feature" "$DEFCC" '-DGGGGC_GENERATIONS=1'
         doTests "$feature" "$DEFCC" '-DGGGGC_GENERATIONS=5'
+        doTests "$feature" "$DEFCC" '-DGGGGC_CONCURRENT_MARKING'
+        doTests "$feature" "$DEFCC" '-DGGGGC_INCREMENTAL_MARKING'
+        doTests "$feature" "$DEFCC" '-DGGGGC_BREAK_TABLE_COMPACTION'
+        doTests "$feature" "$DEFCC" '-DGGGGC_SLOT_LOGGING'
+        doTests "$feature" "$DEFCC" '-DGGGGC_FILTERING_BARRIER'
+        doTests "$feature" "$DEFCC" '-DGGGGC_SURVIVOR_SPACES'
+        doTests "$feature" "$DEFCC" '-DGGGGC_LARGE_OBJECT_WORDS=256'
+        doTests "$feature" "$DEFCC" '-DGGGGC_PAUSE_TARGET=2000 -DGGGGC_GC_OVERHEAD=10 -DGGGGC_HEAP_MAX_POOLS=64'
+        doTests "$feature" "$DEFCC" '-DGGGGC_POOL_IDLE_COLLECTIONS=1'
         doTests "$feature" "$DEFCC" '-DGGGGC_COLLECTOR=portablems'
 
         doTests "$feature" "$DEFCC" '-DGGGGC_USE_MALLOC'
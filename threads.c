@@ -45,6 +45,27 @@ static void *ggggcThreadWrapper(void *arg)
 
     GGC_RD(ti, func)(GGC_RP(ti, arg));
 
+#ifdef GGGGC_SNAPSHOT_MARKING
+    {
+        /* the old generation may still point into our pools, and snapshot
+         * marking can keep such dead objects alive, so empty our pools before
+         * giving them back */
+        struct GGGGC_Pool *pool = ggggc_gen0;
+        while (pool) {
+            if (pool->free != pool->start) {
+                ggggc_collect0(0);
+                pool = ggggc_gen0;
+            } else {
+                pool = pool->next;
+            }
+        }
+        ggggc_satbFlush();
+    }
+#endif
+#ifdef GGGGC_SLOT_LOGGING
+    ggggc_slotLogFlush();
+#endif
+
     /* now remove this thread from the thread barrier */
     while (ggc_mutex_trylock(&ggggc_worldBarrierLock) != 0)
         GGC_YIELD();
@@ -64,6 +85,14 @@ static ggc_thread_local struct GGGGC_PointerStackList blockedPointerStackListNod
 /* call this before blocking */
 void ggc_pre_blocking()
 {
+#ifdef GGGGC_SNAPSHOT_MARKING
+    /* our logged pointers can't wait for us */
+    ggggc_satbFlush();
+#endif
+#ifdef GGGGC_SLOT_LOGGING
+    ggggc_slotLogFlush();
+#endif
+
     /* get a lock on the thread count etc */
     while (ggc_mutex_trylock(&ggggc_worldBarrierLock) != 0)
         GGC_YIELD();
@@ -129,6 +158,68 @@ void ggc_post_blocking()
     ggc_mutex_unlock(&ggggc_worldBarrierLock);
 }
 
+#if defined(GGGGC_THREADS_POSIX) || defined(GGGGC_THREADS_MACOSX)
+/* only the forking thread survives a fork, so the child has to forget the
+ * others. Their stacks, and so their roots, are gone (and will be reused for
+ * new threads), but the old generation may still refer to young objects of
+ * threads which were blocked, so we adopt their pools. */
+static void forkPrepare()
+{
+    /* no collection may be in progress across the fork */
+    while (ggc_mutex_trylock(&ggggc_worldBarrierLock) != 0)
+        GGC_YIELD();
+}
+
+static void forkParent()
+{
+    ggc_mutex_unlock(&ggggc_worldBarrierLock);
+}
+
+static void forkChild()
+{
+    static ggc_mutex_t lockInit = GGC_MUTEX_INITIALIZER;
+    struct GGGGC_PoolList *plCur;
+    struct GGGGC_Pool *pool;
+
+    /* we're the only thread now */
+    ggc_barrier_destroy(&ggggc_worldBarrier);
+    ggggc_threadCount = 1;
+    ggc_barrier_init(&ggggc_worldBarrier, ggggc_threadCount);
+
+    for (plCur = ggggc_blockedThreadPool0s; plCur; plCur = plCur->next) {
+        if (!plCur->pool) continue;
+        if (ggggc_gen0) {
+            for (pool = ggggc_gen0; pool->next; pool = pool->next);
+            pool->next = plCur->pool;
+        } else {
+            ggggc_gen0 = ggggc_pool0 = plCur->pool;
+        }
+    }
+    ggggc_blockedThreadPool0s = NULL;
+    ggggc_blockedThreadPointerStacks = NULL;
+#ifdef GGGGC_FEATURE_JITPSTACK
+    ggggc_blockedThreadJITPointerStacks = NULL;
+#endif
+
+    /* and other threads may have been holding these */
+    ggggc_descriptorDescriptorsLock = lockInit;
+    ggggc_collectorForkChild();
+
+    ggc_mutex_unlock(&ggggc_worldBarrierLock);
+}
+
+/* install our fork handlers, once there are threads to forget (call with the
+ * world barrier lock held) */
+static void forkHandlersInit()
+{
+    static int installed = 0;
+    if (!installed) {
+        installed = 1;
+        pthread_atfork(forkPrepare, forkParent, forkChild);
+    }
+}
+#endif
+
 #if defined(GGGGC_THREADS_POSIX)
 #include "threads/posix.c"
 
@@ -81,6 +81,7 @@ int ggc_thread_create(
     if (ggggc_threadCount == (ggc_size_t) -1) ggggc_threadCount = 1;
     else ggc_barrier_destroy(&ggggc_worldBarrier);
     ggc_barrier_init(&ggggc_worldBarrier, ++ggggc_threadCount);
+    forkHandlersInit();
     ggc_mutex_unlock(&ggggc_worldBarrierLock);
 
     /* spawn the pthread */
@@ -40,6 +40,11 @@ BLOCKING(
     pthread_mutex_lock(mutex)
 )
 
+BLOCKING(
+    ggc_sem_wait(ggc_sem_t *sem),
+    (sem_wait(sem) ? errno : 0)
+)
+
 int ggc_thread_create(
         ggc_thread_t *thread,
         void (*func)(GGC_ThreadArg),
@@ -60,6 +65,7 @@ int ggc_thread_create(
     if (ggggc_threadCount == (ggc_size_t) -1) ggggc_threadCount = 1;
     else ggc_barrier_destroy(&ggggc_worldBarrier);
     ggc_barrier_init(&ggggc_worldBarrier, ++ggggc_threadCount);
+    forkHandlersInit();
     ggc_mutex_unlock(&ggggc_worldBarrierLock);
 
     /* spawn the pthread */
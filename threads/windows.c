@@ -55,6 +55,11 @@ BLOCKING(
     WaitForSingleObject(*(mutex), INFINITE)
 )
 
+BLOCKING(
+    ggc_sem_wait(ggc_sem_t *sem),
+    (WaitForSingleObject(*(sem), INFINITE) != WAIT_FAILED)
+)
+
 int ggc_mutex_lock_raw(ggc_mutex_t *mutex)
 {
     if (!*mutex) initLock(mutex);